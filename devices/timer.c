@@ -1,12 +1,15 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -20,53 +23,146 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* 8254 input frequency. */
+#define PIT_HZ 1193180
+
+/* 8254 counts per timer tick, rounded to nearest. */
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* If true, stop the periodic tick while only the idle thread is
+   runnable.  Controlled by kernel command-line option
+   "-tickless". */
+bool timer_tickless;
+
+/* If nonzero, the number of loops per timer tick, so that
+   timer_calibrate() need not measure it.  Controlled by kernel
+   command-line option "-lpj=N". */
+unsigned timer_lpj;
+
+/* Ticks covered by the one-shot count programmed by
+   timer_idle_enter(), or 0 if the 8254 is in periodic mode. */
+static int64_t oneshot_ticks;
+
+/* 8254 count programmed for the current one-shot, and how much of
+   it remained of the periodic tick in progress at that time. */
+static unsigned oneshot_count;
+static unsigned oneshot_first;
+
+/* Number of timer interrupts elided in tickless mode. */
+static int64_t elided_ticks;
+
+/* Number of TSC cycles spent in the timer interrupt handler. */
+static uint64_t intr_cycles;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Loops timed by timer_calibrate(), and how many times. */
+#define LPJ_SAMPLE_LOOPS (1 << 16)
+#define LPJ_SAMPLE_CNT 3
+
+/* TSC clocksource, calibrated against the 8254 by
+   tsc_calibrate().  A TSC cycle count C is C * tsc_mult >> 32
+   nanoseconds.  Until calibration, tsc_hz is 0 and timer_ns()
+   only has tick resolution. */
+static uint64_t tsc_hz;             /* TSC cycles per second. */
+static uint64_t tsc_mult;           /* 2**32 ns per TSC cycle. */
+static uint64_t tsc_per_tick;       /* TSC cycles per timer tick. */
+static uint64_t boot_tsc;           /* TSC at timer_init(). */
+static bool tsc_invariant;          /* Constant rate in all states? */
+
+/* High-resolution timers.  A thread that sleeps for less than a
+   tick blocks on an hrtimer, and the 8254 is switched to one-shot
+   mode so that it interrupts when the earliest hrtimer expires,
+   then again at the next tick boundary, after which it goes back
+   to periodic mode.  Sleeps shorter than HRTIMER_MIN_NS busy-wait
+   instead: reprogramming the 8254, taking its interrupt and
+   switching threads twice costs about as much, and the 8254 cannot
+   time them anyway. */
+#define HRTIMER_MIN_NS (20 * 1000)
+
+struct hrtimer {
+	uint64_t deadline;              /* TSC at which to wake up. */
+	struct thread *thread;          /* Sleeping thread. */
+	struct list_elem elem;          /* Element in hrtimers. */
+};
+
+/* Pending hrtimers, earliest deadline first. */
+static struct list hrtimers;
+
+/* What the 8254 counter 0 is doing. */
+static enum {
+	PIT_PERIODIC,                   /* Periodic tick, mode 2. */
+	PIT_HRTIMER,                    /* One-shot for an hrtimer. */
+	PIT_TO_TICK                     /* One-shot to the tick boundary. */
+} pit_mode;
+
+/* TSC at the most recent timer tick. */
+static uint64_t last_tick_tsc;
+
+/* Number of hrtimers expired. */
+static int64_t hrtimer_cnt;
+
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void pit_set_periodic (void);
+static void pit_set_oneshot (unsigned count);
+static unsigned pit_read_count (void);
+static void tsc_calibrate (void);
+static void hrtimer_sleep (int64_t ns);
+static void hrtimer_expire (uint64_t now);
+static void hrtimer_program (uint64_t now);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
-
+	list_init (&hrtimers);
+	boot_tsc = last_tick_tsc = rdtsc ();
+	pit_set_periodic ();
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays.
+
+   Once the TSC rate is known, timing a fixed number of loops
+   against the TSC gives loops_per_tick directly, which is much
+   faster than searching for the largest count that fits in a
+   tick.  The fastest of a few runs is used, in case an interrupt
+   or the host got in the way of the others. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	uint64_t best = UINT64_MAX;
+	uint64_t lpj;
+	int i;
 
 	ASSERT (intr_get_level () == INTR_ON);
+	tsc_calibrate ();
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
+	if (timer_lpj != 0) {
+		loops_per_tick = timer_lpj;
+		printf ("%'"PRIu64" loops/s (preset).\n",
+				(uint64_t) loops_per_tick * TIMER_FREQ);
+		return;
 	}
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	for (i = 0; i < LPJ_SAMPLE_CNT; i++) {
+		enum intr_level old_level = intr_disable ();
+		uint64_t start = rdtsc ();
+		busy_wait (LPJ_SAMPLE_LOOPS);
+		uint64_t cycles = rdtsc () - start;
+		intr_set_level (old_level);
 
+		if (cycles < best)
+			best = cycles;
+	}
+
+	lpj = (uint64_t) LPJ_SAMPLE_LOOPS * tsc_per_tick / (best > 0 ? best : 1);
+	loops_per_tick = lpj > UINT_MAX ? UINT_MAX : lpj > 0 ? lpj : 1;
 	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
 
@@ -97,6 +193,23 @@ timer_sleep (int64_t ticks) {
 	sleep_thread(start + ticks);
 }
 
+/* Returns the number of nanoseconds since the OS booted.  The
+   result never decreases.  Before the TSC is calibrated its
+   resolution is one tick. */
+uint64_t
+timer_ns (void) {
+	if (tsc_mult == 0)
+		return timer_ticks () * (1000 * 1000 * 1000 / TIMER_FREQ);
+	return timer_cycles_to_ns (rdtsc () - boot_tsc);
+}
+
+/* Converts CYCLES, a difference between two TSC readings, to
+   nanoseconds.  Returns 0 before the TSC has been calibrated. */
+uint64_t
+timer_cycles_to_ns (uint64_t cycles) {
+	return ((unsigned __int128) cycles * tsc_mult) >> 32;
+}
+
 /* Suspends execution for approximately MS milliseconds. */
 void
 timer_msleep (int64_t ms) {
@@ -115,50 +228,186 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Returns the number of TSC cycles spent so far in the timer
+   interrupt handler. */
+uint64_t
+timer_intr_cycles (void) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t c = intr_cycles;
+	intr_set_level (old_level);
+	return c;
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (hrtimer_cnt != 0)
+		printf ("Timer: %"PRId64" high-resolution timers expired\n", hrtimer_cnt);
+	if (timer_tickless)
+		printf ("Timer: %"PRId64" idle ticks without interrupt\n", elided_ticks);
+}
+
+/* Called by the idle thread, with interrupts off, right before it
+   halts.  Replaces the periodic tick with a single interrupt at
+   the next tick that has work to do: the next sleeper wakeup or,
+   under the MLFQS, the next priority recomputation.  The 8254
+   count is only 16 bits wide, so the tick can be stopped for a
+   few ticks at most. */
+void
+timer_idle_enter (void) {
+	int64_t deadline, delta, max_delta;
+	unsigned first;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!timer_tickless || oneshot_ticks != 0)
+		return;
+	if (pit_mode != PIT_PERIODIC || !list_empty (&hrtimers))
+		return;
+
+	deadline = get_next_wakeup_tick ();
+	if (thread_mlfqs && deadline > (ticks / 4 + 1) * 4)
+		deadline = (ticks / 4 + 1) * 4;
+	delta = deadline - ticks;
+	if (delta <= 1)
+		return;
+
+	/* Keep the part of the current tick that has not elapsed yet,
+	   so the next interrupt still lands on a tick boundary. */
+	first = pit_read_count ();
+	if (first == 0 || first > PIT_TICK_COUNT)
+		first = PIT_TICK_COUNT;
+	max_delta = (0xffff - first) / PIT_TICK_COUNT + 1;
+	if (delta > max_delta)
+		delta = max_delta;
+	if (delta <= 1)
+		return;
+
+	oneshot_ticks = delta;
+	oneshot_first = first;
+	oneshot_count = first + (delta - 1) * PIT_TICK_COUNT;
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, oneshot_count & 0xff);
+	outb (0x40, oneshot_count >> 8);
+}
+
+/* Called by the idle thread, with interrupts off, after it wakes
+   up.  If an interrupt other than the timer's woke us before the
+   one-shot expired, catches TICKS up with the ticks that passed
+   and goes back to the periodic tick. */
+void
+timer_idle_exit (void) {
+	unsigned elapsed;
+	int64_t passed = 0;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (oneshot_ticks == 0)
+		return;
+
+	elapsed = oneshot_count - pit_read_count ();
+	if (elapsed >= oneshot_first)
+		passed = 1 + (elapsed - oneshot_first) / PIT_TICK_COUNT;
+	if (passed >= oneshot_ticks)
+		passed = oneshot_ticks - 1;
+
+	ticks += passed;
+	elided_ticks += passed;
+	thread_idle_ticks (passed);
+	oneshot_ticks = 0;
+	pit_set_periodic ();
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	uint64_t start = rdtsc ();
+
+	if (pit_mode != PIT_PERIODIC) {
+		/* One-shot for an hrtimer.  Unless we have also reached the
+		   tick boundary, this is not a tick. */
+		uint64_t tick_tsc = last_tick_tsc + tsc_per_tick;
+		if (start + tsc_per_tick / 64 < tick_tsc) {
+			hrtimer_expire (start);
+			hrtimer_program (start);
+			intr_cycles += rdtsc () - start;
+			return;
+		}
+
+		/* Catch up if hrtimers kept us past more than one tick. */
+		while (start >= tick_tsc + tsc_per_tick) {
+			ticks++;
+			tick_tsc += tsc_per_tick;
+		}
+		pit_mode = PIT_PERIODIC;
+		pit_set_periodic ();
+	}
+
+	if (oneshot_ticks != 0) {
+		/* One-shot from timer_idle_enter() expired: account for the
+		   ticks we slept through, then resume the periodic tick. */
+		ticks += oneshot_ticks - 1;
+		elided_ticks += oneshot_ticks - 1;
+		thread_idle_ticks (oneshot_ticks - 1);
+		oneshot_ticks = 0;
+		pit_set_periodic ();
+	}
+
 	ticks++;
 	thread_tick ();
 
 	if (thread_mlfqs) { // advanced scdular activate
 		running_thr_incr_recent_cpu();
 		if (ticks % TIMER_FREQ == 0){
-			cal_load_avg();
-			recal_all_recent_cpu();
-			recal_all_priority();
+			recal_per_second();
 		} else if (ticks % 4 == 0){
-			recal_all_priority();
+			// 나머지 thread는 ready queue에 들어갈 때 재계산
+			cal_priority(thread_current());
 		}
 	}
 
 	if(get_next_wakeup_tick() <= ticks){
 		awake_thread(ticks);
 	}
+
+	last_tick_tsc = start;
+	if (!list_empty (&hrtimers)) {
+		hrtimer_expire (start);
+		hrtimer_program (start);
+	}
+
+	intr_cycles += rdtsc () - start;
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
+/* Sets up the 8254 to interrupt TIMER_FREQ times per second. */
+static void
+pit_set_periodic (void) {
+	uint16_t count = PIT_TICK_COUNT;
 
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+/* Makes 8254 counter 0 interrupt once, after COUNT input
+   cycles. */
+static void
+pit_set_oneshot (unsigned count) {
+	ASSERT (count > 0 && count <= 0xffff);
+
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns the current count of 8254 counter 0. */
+static unsigned
+pit_read_count (void) {
+	unsigned lo, hi;
+
+	outb (0x43, 0x00);    /* CW: counter 0, latch count. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return lo | (hi << 8);
 }
 
 /* Iterates through a simple loop LOOPS times, for implementing
@@ -184,18 +433,140 @@ real_time_sleep (int64_t num, int32_t denom) {
 	   1 s / TIMER_FREQ ticks
 	   */
 	int64_t ticks = num * TIMER_FREQ / denom;
+	int64_t ns;
 
 	ASSERT (intr_get_level () == INTR_ON);
+	ASSERT (denom % 1000 == 0);
+	ns = num * (1000 * 1000) / (denom / 1000); /* Scaled as below. */
 	if (ticks > 0) {
 		/* We're waiting for at least one full timer tick.  Use
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
 		timer_sleep (ticks);
+	} else if (tsc_hz != 0 && ns >= HRTIMER_MIN_NS) {
+		/* Long enough to be worth blocking on an hrtimer. */
+		hrtimer_sleep (ns);
 	} else {
 		/* Otherwise, use a busy-wait loop for more accurate
 		   sub-tick timing.  We scale the numerator and denominator
 		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
 		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
 	}
 }
+
+/* Measures the TSC rate against 8254 counter 2, which is gated
+   through port 0x61 and whose output can be read back there, so
+   no interrupt is needed.  Counts down a fixed 10 ms with
+   interrupts off and sees how far the TSC advanced. */
+static void
+tsc_calibrate (void) {
+	const unsigned latch = PIT_HZ / 100;
+	enum intr_level old_level;
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t start, end;
+	uint8_t port61;
+
+	old_level = intr_disable ();
+	port61 = inb (0x61);
+	outb (0x61, (port61 & ~0x02) | 0x01);   /* Gate on, speaker off. */
+	outb (0x43, 0xb0);    /* CW: counter 2, LSB then MSB, mode 0, binary. */
+	outb (0x42, latch & 0xff);
+	outb (0x42, latch >> 8);
+	start = rdtsc ();
+	while ((inb (0x61) & 0x20) == 0)        /* Wait for OUT2 to rise. */
+		continue;
+	end = rdtsc ();
+	outb (0x61, port61);
+	intr_set_level (old_level);
+
+	tsc_hz = (end - start) * PIT_HZ / latch;
+	tsc_mult = ((uint64_t) 1000 * 1000 * 1000 << 32) / tsc_hz;
+	tsc_per_tick = tsc_hz / TIMER_FREQ;
+
+	cpuid (0x80000000, &eax, &ebx, &ecx, &edx);
+	if (eax >= 0x80000007) {
+		cpuid (0x80000007, &eax, &ebx, &ecx, &edx);
+		tsc_invariant = (edx & (1u << 8)) != 0;
+	}
+	printf ("TSC: %'"PRIu64" kHz%s.\n", tsc_hz / 1000,
+			tsc_invariant ? "" : " (not invariant)");
+}
+
+/* Blocks the current thread for about NS nanoseconds, less than a
+   tick, on an hrtimer. */
+static void
+hrtimer_sleep (int64_t ns) {
+	struct hrtimer timer;
+	enum intr_level old_level;
+	struct list_elem *e;
+	uint64_t now;
+
+	if (ns <= 0)
+		return;
+
+	old_level = intr_disable ();
+	timer_idle_exit ();   /* Back to the periodic tick if still tickless. */
+	now = rdtsc ();
+	timer.deadline = now + (uint64_t) ns * tsc_hz / (1000 * 1000 * 1000);
+	timer.thread = thread_current ();
+
+	for (e = list_begin (&hrtimers); e != list_end (&hrtimers);
+			e = list_next (e))
+		if (list_entry (e, struct hrtimer, elem)->deadline > timer.deadline)
+			break;
+	list_insert (e, &timer.elem);
+
+	hrtimer_program (now);
+	thread_block ();
+	intr_set_level (old_level);
+}
+
+/* Wakes up the threads whose hrtimers expired by NOW.  Called
+   with interrupts off. */
+static void
+hrtimer_expire (uint64_t now) {
+	while (!list_empty (&hrtimers)) {
+		struct hrtimer *h = list_entry (list_front (&hrtimers),
+				struct hrtimer, elem);
+		if (h->deadline > now)
+			break;
+
+		list_pop_front (&hrtimers);
+		thread_unblock (h->thread);
+		hrtimer_cnt++;
+		if (intr_context ()
+				&& h->thread->priority > thread_current ()->priority)
+			intr_yield_on_return ();
+	}
+}
+
+/* If the earliest hrtimer expires before the next tick, programs
+   the 8254 to interrupt then; if the 8254 is in one-shot mode and
+   no hrtimer is due before the tick, programs it for the tick
+   boundary.  Called with interrupts off. */
+static void
+hrtimer_program (uint64_t now) {
+	uint64_t tick_tsc = last_tick_tsc + tsc_per_tick;
+	uint64_t target = tick_tsc;
+	uint64_t count;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (oneshot_ticks == 0);
+
+	if (!list_empty (&hrtimers)) {
+		uint64_t deadline = list_entry (list_front (&hrtimers),
+				struct hrtimer, elem)->deadline;
+		if (deadline < target)
+			target = deadline;
+	}
+	if (target == tick_tsc && pit_mode == PIT_PERIODIC)
+		return;     /* The periodic tick comes first anyway. */
+
+	count = target > now ? (target - now) * PIT_HZ / tsc_hz : 0;
+	if (count < 1)
+		count = 1;
+	if (count > 0xffff)
+		count = 0xffff;
+	pit_mode = target == tick_tsc ? PIT_TO_TICK : PIT_HRTIMER;
+	pit_set_oneshot (count);
+}
@@ -6,7 +6,11 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/fat.h" // P4-2-0 추가
+#ifdef VM
+#include "vm/vm.h"
+#endif
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -42,6 +46,10 @@ struct inode {
 	struct inode_disk data;             /* Inode content. */
 };
 
+/* Cache of struct inode, which is too big for malloc() to hold
+ * without wasting most of a 1 kB block. */
+static struct kmem_cache *inode_cachep;
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
@@ -87,6 +95,7 @@ static struct list open_inodes;
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	inode_cachep = kmem_cache_create ("inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -189,7 +198,7 @@ inode_open (disk_sector_t sector) {
 	}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = kmem_cache_alloc (inode_cachep);
 	if (inode == NULL)
 		return NULL;
 
@@ -248,7 +257,7 @@ inode_close (struct inode *inode) {
 			#endif
 		}
 
-		free (inode); 
+		kmem_cache_free (inode_cachep, inode);
 	}
 }
 
@@ -406,6 +415,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	}
 	free (bounce);
 
+#ifdef VM
+	/* Keep pages of this file in the VM page cache up to date. */
+	if (bytes_written > 0)
+		vm_cache_update (inode, buffer_, offset - bytes_written, bytes_written);
+#endif
 	return bytes_written;
 }
 
@@ -0,0 +1,32 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* LZ77 compression.
+ *
+ * A small, fast compressor in the LZ4 mold: the output is a
+ * sequence of literal runs, each followed by a back-reference of
+ * at least LZ_MIN_MATCH bytes at most 65535 bytes back, found
+ * through a hash table of recent positions.  It is meant for
+ * compressing pages, so inputs are limited to LZ_MAX_INPUT bytes.
+ *
+ * Compression needs a struct lz_state as scratch space.  It is
+ * too big for a kernel stack, so the caller supplies it. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZ_MIN_MATCH 4          /* Shortest back-reference. */
+#define LZ_MAX_INPUT 65536      /* Largest input, in bytes. */
+#define LZ_HASH_BITS 12         /* log2 of hash table size. */
+
+/* Scratch space for lz_compress(). */
+struct lz_state {
+	uint16_t table[1 << LZ_HASH_BITS];  /* Last position per hash. */
+};
+
+size_t lz_compress (struct lz_state *, const void *src, size_t src_size,
+		void *dst, size_t dst_cap);
+size_t lz_decompress (const void *src, size_t src_size,
+		void *dst, size_t dst_cap);
+
+#endif /* lib/kernel/lz.h */
@@ -38,4 +38,7 @@ enum {
 	SYS_UMOUNT,
 };
 
+/* Flags for mmap(), ORed into its WRITABLE argument. */
+#define MAP_POPULATE 0x100      /* Fault in the whole mapping at once. */
+
 #endif /* lib/syscall-nr.h */
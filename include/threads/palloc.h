@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -11,6 +12,13 @@ enum palloc_flags {
 	PAL_USER = 004              /* User page. */
 };
 
+/* Free pages are kept in blocks of 2**K pages, for K from 0 to
+   PALLOC_MAX_ORDER.  Allocations larger than the biggest block
+   need that many adjacent free blocks of the biggest order, and
+   scan the whole pool for them. */
+#define PALLOC_MAX_ORDER 10
+#define PALLOC_ORDER_CNT (PALLOC_MAX_ORDER + 1)
+
 /* Maximum number of pages to put in user pool. */
 extern size_t user_page_limit;
 
@@ -19,5 +27,10 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_get_free_counts (enum palloc_flags,
+		size_t free_cnt[PALLOC_ORDER_CNT]);
+size_t palloc_free_page_cnt (enum palloc_flags);
+bool palloc_prezero (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
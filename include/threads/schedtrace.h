@@ -0,0 +1,58 @@
+#ifndef THREADS_SCHEDTRACE_H
+#define THREADS_SCHEDTRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Scheduler event tracing.
+
+   When enabled with "-o sched-trace", the scheduler records its
+   events, timestamped with the TSC, into a fixed-size ring
+   buffer.  Once the buffer is full the oldest events are
+   overwritten.  The "savetrace FILE" action writes the buffer to
+   a file, which `pintos -g' can copy out for utils/sched-trace
+   to analyze. */
+
+/* Kinds of events.  The numbering is part of the dump format. */
+enum sched_event_type {
+	SCHED_EV_SWITCH = 1,        /* TID starts running, ARG stops. */
+	SCHED_EV_BLOCK,             /* TID blocks. */
+	SCHED_EV_UNBLOCK,           /* TID made ready by thread ARG. */
+	SCHED_EV_DONATE,            /* TID receives PRIORITY from ARG. */
+	SCHED_EV_SLEEP,             /* TID sleeps until tick ARG. */
+	SCHED_EV_WAKE,              /* TID wakes up at tick ARG. */
+	SCHED_EV_CREATE,            /* TID created by thread ARG. */
+	SCHED_EV_EXIT,              /* TID exits. */
+};
+
+/* One trace record, 24 bytes in the dump. */
+struct sched_event {
+	uint64_t tsc;               /* Time stamp counter. */
+	int32_t tid;                /* Thread the event is about. */
+	int32_t arg;                /* Depends on TYPE. */
+	uint8_t type;               /* enum sched_event_type. */
+	uint8_t priority;           /* TID's priority after the event. */
+	uint8_t reserved[6];
+};
+
+/* If true, record scheduler events.
+   Controlled by kernel command-line option "-sched-trace". */
+extern bool sched_trace_enabled;
+
+struct thread;
+
+void sched_trace_record (enum sched_event_type, const struct thread *,
+		int32_t arg);
+void sched_trace_save (char **argv);
+void sched_trace_dump (void);
+void sched_trace_print_stats (void);
+
+/* Records an event of TYPE about thread T, if tracing is on. */
+static inline void
+sched_trace (enum sched_event_type type, const struct thread *t,
+		int32_t arg) {
+	if (sched_trace_enabled)
+		sched_trace_record (type, t, arg);
+}
+
+#endif /* threads/schedtrace.h */
@@ -0,0 +1,27 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <stddef.h>
+
+/* Object caches.
+
+   A cache hands out objects of one fixed size, carved out of
+   page-sized slabs, so that a frequently allocated structure does
+   not pay for malloc()'s rounding up to a power of 2.  Create one
+   cache per structure type at initialization time.
+
+   If a cache has a constructor, it runs once on each object when
+   its slab is created, not on every allocation: objects must be
+   handed back to kmem_cache_free() in their constructed state. */
+
+struct kmem_cache;
+
+typedef void kmem_ctor_func (void *obj);
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size,
+		kmem_ctor_func *ctor);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *obj);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
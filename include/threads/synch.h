@@ -1,13 +1,26 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
+struct thread;
+
+/* Spinlock. */
+struct spinlock {
+	int locked;                 /* 1 while held, 0 otherwise. */
+};
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, by priority. */
+	struct spinlock lock;       /* Protects value and waiters. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -15,11 +28,14 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
+int sema_highest_priority (struct semaphore *);
+void sema_reposition_waiter (struct semaphore *, struct thread *);
 
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	struct list_elem elem;      /* Holder's held_locks element. */
 };
 
 void lock_init (struct lock *);
@@ -102,17 +102,31 @@ struct thread {
 	int init_priority; // 처음 priority (donation 종료 후 돌아가기 위함)
 	
 	struct lock *wait_on_lock; // thread가 기다리는(필요한, wait) lock
-	struct list donation_list; // priority를 donate 해준 thread list
-	struct list_elem donation_elem; //donation_list의 elem
+	struct list held_locks; // thread가 가지고 있는 lock list (donation은 각 lock의 waiter heap top)
+
+	// semaphore 대기 (synch.c)
+	struct semaphore *wait_on_sema; // thread가 기다리는 semaphore
+	struct heap_elem sema_elem; // semaphore waiters heap의 elem
+	uint64_t sema_seq; // 같은 priority면 먼저 온 thread 먼저
 
 	// P1-3 advanced scheduler 변수
 	int recent_cpu;
 	int nice;
+	int64_t recent_cpu_epoch; // recent_cpu에 마지막으로 decay 적용한 epoch
+
+	// fair scheduler (-fair) 변수
+	int64_t vruntime; // weight로 나눈 누적 실행 시간 (TSC cycle)
+	uint64_t exec_start; // 마지막으로 vruntime에 반영한 시점의 TSC
+	struct heap_elem fair_elem; // fair_queue의 elem
+
+	// malloc 크기별 magazine (malloc.c), 처음 malloc/free 할 때 할당
+	struct magazine *mags;
 
 	// P2-3 system call 관련 변수
 	int exit_status; // process_exit(), wait()에서 필요
 
 	struct list *fd_list; // file descripter elem의 list
+	struct list fd_list_head; // fd_list가 가리키는 list (thread_create에서 연결)
 
 	// P2-3-fork-0 fork 관련 변수
 	struct list child_list; // children thread list
@@ -152,16 +166,23 @@ struct thread {
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the fair-share scheduler, which runs the ready
+   thread with the least weighted virtual runtime.
+   Controlled by kernel command-line option "-fair". */
+extern bool thread_fair;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t ticks);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
+void thread_block_spin (struct spinlock *);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
@@ -192,18 +213,15 @@ bool thr_cmp_priority (const struct list_elem *x, const struct list_elem *y, voi
 void test_highest_priority (void); // current thread와 ready_list의 높은 순위 thread 비교해서 yield 결정
 
 // donation
-bool thr_donation_cmp_priority(const struct list_elem *x, const struct list_elem *y, void *aux UNUSED); // x, y(donation_list의 elem) 의 priority 비교
-void donate_priority(void); // lock 얻을 때 priority donate (depth 8)
-void remove_with_lock_in_donation_list(struct lock *lock); // cur_thread의 donation_list에서 lock에 해당된 thread remove
-void update_priority (void); // donate 끝나고 priority update
+void donate_priority(void); // lock 얻을 때 wait_on_lock chain 따라 priority donate
+void update_priority (void); // init_priority와 held_locks의 waiter heap top 중 max로 priority update
 
 // advanced scheduler
 void cal_priority (struct thread *t);
-void cal_recent_cpu (struct thread *t);
+void cal_recent_cpu (struct thread *t); // 놓친 epoch의 decay 적용
 void cal_load_avg (void);
 
 void running_thr_incr_recent_cpu (void); //running thread의 recent_cpu 1tick마다 1씩 증가
-void recal_all_recent_cpu (void); // all thread의 recent_cpu 재계산
-void recal_all_priority(void); // all thread의 priority 재계산
+void recal_per_second (void); // load_avg, 새 epoch, running/ready thread 재계산
 
 #endif /* threads/thread.h */
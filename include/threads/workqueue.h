@@ -0,0 +1,34 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Deferred work.
+
+   An interrupt handler that has work which does not need to
+   happen before the interrupt returns can queue it here instead
+   of doing it with interrupts off.  Queued work runs in order in
+   the "kworker" kernel thread, which has the highest priority,
+   so it normally runs as soon as the interrupt returns.  Work
+   functions run in thread context with interrupts on and may
+   sleep. */
+
+typedef void work_func (void *aux);
+
+/* A unit of deferred work.  Embed one in a longer-lived object
+   and queue it as often as needed: queuing work that is already
+   pending does nothing, so it runs once for any number of
+   requests made before it starts. */
+struct work {
+	struct list_elem elem;      /* List element in the work queue. */
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Argument for FUNC. */
+	bool pending;               /* Queued but not yet started? */
+};
+
+void workqueue_init (void);
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct work *);
+
+#endif /* threads/workqueue.h */
@@ -1,6 +1,7 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 #include "threads/synch.h"
+#include "threads/slab.h"
 #include "filesys/off_t.h"
 
 void syscall_init (void);
@@ -21,6 +22,9 @@ struct fd_list_elem { // fd_list에 사용할 elem
     struct file *file_ptr;
 };
 
+// fd_list_elem 할당용 object cache, syscall_init()에서 생성
+extern struct kmem_cache *fd_elem_cachep;
+
 // P2-3-1 System call 함수
 void halt (void);
 void exit (int status);
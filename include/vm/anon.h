@@ -4,6 +4,7 @@
 #include <bitmap.h>
 #include "threads/synch.h"
 struct page;
+struct zswap_entry;
 enum vm_type;
 
 struct anon_page {
@@ -12,6 +13,8 @@ struct anon_page {
     struct page_load_info *aux;
     // P3-5-0 swap 필요 변수
     int num_swap_table;
+    // zswap에 압축되어 있으면 그 entry
+    struct zswap_entry *zentry;
 };
 
 // P3-5-0 swap_table 변수 선언
@@ -20,7 +23,14 @@ struct args_swap {
     struct lock lock_swap;
 };
 
+/* Most pages written or read ahead in one swap disk request. */
+#define SWAP_CLUSTER_MAX 8
+
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_out_cluster (struct page *pages[], size_t cnt);
+void anon_copy_swapped (struct page *src, void *kva);
+size_t swap_write_page (const void *kva);
+void swap_print_stats (void);
 
 #endif
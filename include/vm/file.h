@@ -17,9 +17,13 @@ struct file_page {
 
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_cache_claim (struct page *page);
+bool file_page_near (struct page *page, struct page *other);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+bool file_map_text (void *upage, size_t size, struct file *file, off_t ofs,
+		size_t read_bytes);
 // 추가 함수
 static bool file_lazy_load_segment (struct page *page, void *aux);
 #endif
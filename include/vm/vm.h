@@ -2,6 +2,7 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include <hash.h>
 
 enum vm_type {
@@ -28,12 +29,14 @@ enum vm_type {
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/vma.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
 
 struct page_operations;
 struct thread;
+struct inode;
 
 #define VM_TYPE(type) ((type) & 7)
 
@@ -53,8 +56,10 @@ struct page {
 	bool writable;
 	enum vm_type page_vm_type;
 
-	// P3-victim-0 victim_list_elem 변수 추가
-	struct list_elem victim_list_elem;
+	struct thread *owner;          /* spt에 이 page를 가진 thread. */
+	struct list_elem map_elem;     /* frame->pages의 element. */
+	struct vma *vma;               /* 이 page가 속한 VMA. */
+	struct list_elem vma_elem;     /* vma->pages의 element. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -72,6 +77,21 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
+
+	// frame table 관리용
+	// PAGE는 PAGES의 첫 page, fork 후 copy-on-write로 공유 중이면
+	// 여러 process의 page가 같은 frame을 read-only로 매핑함
+	struct list pages;             /* 이 frame을 매핑한 page들. */
+	int refcnt;                    /* PAGES의 길이. */
+	int pin_cnt;                   /* 0이 아니면 evict 대상에서 제외 (I/O 중). */
+	bool evicting;                 /* swap out 중, 매핑은 다 지워져 있음. */
+	struct list_elem frame_elem;   /* frame_table의 element. */
+
+	// page cache: file의 page를 담은 frame은 (inode, ofs)로 찾아서
+	// 그 page를 매핑하는 process들이 같이 씀
+	struct inode *inode;           /* 담고 있는 file, cache에 없으면 NULL. */
+	off_t ofs;                     /* 담고 있는 page의 file 내 offset. */
+	struct hash_elem cache_elem;   /* page_cache의 element. */
 };
 
 /* The function table for page operations.
@@ -96,8 +116,16 @@ struct page_operations {
 struct supplemental_page_table {
 	// P3-1-1 supplemental_page_table hash table로 구조 선언 
 	struct hash hash_table;
+	// 주소 범위 단위로 기록, page는 처음 접근할때 VMA에서 만듦
+	struct vma_tree vmas;
 };
 
+/* Object caches for struct page, struct frame and
+ * struct page_load_info.  Created by vm_init(). */
+extern struct kmem_cache *page_cachep;
+extern struct kmem_cache *frame_cachep;
+extern struct kmem_cache *load_info_cachep;
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -105,10 +133,24 @@ bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
+struct page *spt_get_page (struct supplemental_page_table *spt, void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+extern int fault_around_pages;
+
 void vm_init (void);
+void vm_print_stats (void);
+void vm_frame_release (struct page *page);
+struct frame *vm_frame_alloc_noevict (void);
+void vm_frame_free (struct frame *frame);
+bool vm_frame_map (struct page *page, struct frame *frame);
+void vm_frame_unpin (struct frame *frame);
+struct frame *vm_frame_pin_dirty (struct page *page);
+bool vm_cache_map (struct page *page, struct inode *inode, off_t ofs);
+void vm_cache_insert (struct frame *frame, struct inode *inode, off_t ofs);
+void vm_cache_update (struct inode *inode, const void *buf, off_t ofs,
+		off_t size);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -118,6 +160,11 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+struct vma *vm_map_range (void *start, size_t size, enum vm_type type,
+		bool writable, struct file *file, off_t ofs, size_t read_bytes,
+		vm_initializer *init);
+void vm_unmap_range (struct vma *vma);
+void vm_prefault (void *addr, size_t length);
 enum vm_type page_get_type (struct page *page);
 
 uint64_t page_hash_hash (const struct hash_elem *e, void *aux);
@@ -0,0 +1,44 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+
+struct file;
+enum vm_type;
+
+/* A virtual memory area: a range of pages of a process that were
+ * mapped together and are set up the same way.  A struct page for
+ * one of them is made only when it is first touched. */
+struct vma {
+	void *start;                /* First page. */
+	void *end;                  /* One past the last page. */
+	enum vm_type type;          /* Type of the pages that hold file data. */
+	bool writable;
+	bool mmap;                  /* mmap()으로 만든 영역, FILE을 가짐. */
+	struct file *file;          /* Pages are read from here, or NULL. */
+	off_t ofs;                  /* Offset in FILE of START. */
+	size_t read_bytes;          /* Bytes of FILE from START, rest zeros. */
+	vm_initializer *init;       /* Loads a page from FILE. */
+	struct list pages;          /* 만들어진 page들, page->vma_elem. */
+	struct vma *left, *right;   /* Children in the VMA tree. */
+};
+
+/* A process's VMAs, ordered by address in a splay tree.  VMAs never
+ * overlap, so ordering them by START orders them by END too. */
+struct vma_tree {
+	struct vma *root;
+};
+
+void vma_tree_init (struct vma_tree *);
+struct vma *vma_find (struct vma_tree *, const void *addr);
+struct vma *vma_next (struct vma_tree *, const void *addr);
+bool vma_overlaps (struct vma_tree *, const void *start, const void *end);
+bool vma_insert (struct vma_tree *, struct vma *);
+void vma_remove (struct vma_tree *, struct vma *);
+bool vma_grow_down (struct vma_tree *, struct vma *, void *start);
+struct vma *vma_pop (struct vma_tree *);
+
+#endif /* vm/vma.h */
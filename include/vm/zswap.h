@@ -0,0 +1,18 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+
+struct page;
+
+/* Compressed cache for swapped-out anon pages, enabled by the
+ * -zswap kernel option.  See zswap.c. */
+extern bool zswap_enabled;
+
+void zswap_init (void);
+bool zswap_store (struct page *page);
+bool zswap_load (struct page *page, void *kva);
+bool zswap_copy (struct page *page, void *kva);
+void zswap_invalidate (struct page *page);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */
@@ -0,0 +1,164 @@
+/* Priority heap.
+
+   See heap.h for basic information. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static struct heap_elem *meld (struct heap *,
+		struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+
+/* Initializes heap H to compare elements using LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->elem_cnt = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into heap H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->child = e->next = e->prev = NULL;
+	h->root = meld (h, h->root, e);
+	h->elem_cnt++;
+}
+
+/* Returns the greatest element in H, or NULL if H is empty. */
+struct heap_elem *
+heap_top (struct heap *h) {
+	ASSERT (h != NULL);
+
+	return h->root;
+}
+
+/* Removes and returns the greatest element in H, or NULL if H is
+   empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *top;
+
+	ASSERT (h != NULL);
+
+	top = h->root;
+	if (top != NULL) {
+		h->root = merge_pairs (h, top->child);
+		h->elem_cnt--;
+	}
+	return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		heap_pop (h);
+		return;
+	}
+
+	/* Cut E's subtree out of the tree. */
+	ASSERT (e->prev != NULL);
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+
+	/* Merge E's children back in. */
+	h->root = meld (h, h->root, merge_pairs (h, e->child));
+	h->elem_cnt--;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (struct heap *h) {
+	return h->root == NULL;
+}
+
+/* Melds the trees rooted at A and B, which have no siblings, and
+   returns the new root.  Either may be NULL. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	struct heap_elem *t;
+
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	/* Make A the greater root.  On ties the older tree stays on
+	   top, which keeps equal elements in insertion order as long
+	   as LESS breaks ties itself. */
+	if (h->less (a, b, h->aux)) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	a->next = a->prev = NULL;
+	return a;
+}
+
+/* Melds the sibling list starting at FIRST into a single tree
+   with the standard two-pass method and returns its root. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+
+	if (first == NULL)
+		return NULL;
+
+	/* First pass: meld siblings pairwise from left to right,
+	   pushing each result onto PAIRS (linked through `next'). */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+		struct heap_elem *m;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+
+		m = meld (h, a, b);
+		m->next = pairs;
+		pairs = m;
+	}
+
+	/* Second pass: meld the pairs from right to left. */
+	first = pairs;
+	pairs = pairs->next;
+	first->next = NULL;
+	while (pairs != NULL) {
+		struct heap_elem *m = pairs;
+		pairs = pairs->next;
+		m->next = NULL;
+		first = meld (h, first, m);
+	}
+	first->prev = NULL;
+	return first;
+}
@@ -0,0 +1,188 @@
+/* LZ77 compression.
+
+   See lz.h for basic information.
+
+   Each sequence starts with a token byte whose high nibble is the
+   number of literals and whose low nibble is the match length
+   minus LZ_MIN_MATCH.  A nibble of 15 means that the length goes
+   on in the bytes that follow: each of them is added to it, up to
+   and including the first one that is not 255.  After the token
+   come the extra literal length bytes, the literals, the match
+   offset as two little-endian bytes and the extra match length
+   bytes.  The last sequence has literals only; the decompressor
+   recognizes it by running out of input after its literals. */
+
+#include "lz.h"
+#include <stdbool.h>
+#include <string.h>
+#include "../debug.h"
+
+/* Returns the 4 bytes at P, which need not be aligned. */
+static inline uint32_t
+read32 (const uint8_t *p) {
+	uint32_t v;
+
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+/* Returns the hash table index for the 4 bytes V. */
+static inline size_t
+hash32 (uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends the extra bytes of a length, LEN, that did not fit in
+   its nibble at *OP, which must stay below END.  Returns false
+   if there is no room. */
+static bool
+put_length (uint8_t **op, uint8_t *end, size_t len) {
+	for (; len >= 255; len -= 255) {
+		if (*op >= end)
+			return false;
+		*(*op)++ = 255;
+	}
+	if (*op >= end)
+		return false;
+	*(*op)++ = len;
+	return true;
+}
+
+/* Appends at *OP, which must stay below END, a sequence of the
+   LIT_LEN literals at LIT followed, unless MATCH_LEN is 0, by a
+   match of MATCH_LEN bytes OFFSET bytes back.  Returns false if
+   there is no room. */
+static bool
+put_sequence (uint8_t **op, uint8_t *end, const uint8_t *lit, size_t lit_len,
+		size_t offset, size_t match_len) {
+	size_t extra = match_len != 0 ? match_len - LZ_MIN_MATCH : 0;
+	uint8_t *token;
+
+	if (*op >= end)
+		return false;
+	token = (*op)++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4 | (extra < 15 ? extra : 15);
+
+	if (lit_len >= 15 && !put_length (op, end, lit_len - 15))
+		return false;
+	if ((size_t) (end - *op) < lit_len)
+		return false;
+	memcpy (*op, lit, lit_len);
+	*op += lit_len;
+
+	if (match_len == 0)
+		return true;
+	if (end - *op < 2)
+		return false;
+	*(*op)++ = offset;
+	*(*op)++ = offset >> 8;
+	if (extra >= 15 && !put_length (op, end, extra - 15))
+		return false;
+	return true;
+}
+
+/* Compresses the SRC_SIZE bytes at SRC, which must not exceed
+   LZ_MAX_INPUT, into DST, using S as scratch space.  Returns the
+   compressed size, or 0 if it would exceed DST_CAP bytes. */
+size_t
+lz_compress (struct lz_state *s, const void *src_, size_t src_size,
+		void *dst_, size_t dst_cap) {
+	const uint8_t *src = src_;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint8_t *end = dst + dst_cap;
+	size_t ip = 0;
+	size_t anchor = 0;
+
+	ASSERT (s != NULL);
+	ASSERT (src_size <= LZ_MAX_INPUT);
+
+	memset (s->table, 0, sizeof s->table);
+	while (ip + LZ_MIN_MATCH <= src_size) {
+		uint32_t v = read32 (src + ip);
+		size_t h = hash32 (v);
+		size_t cand = s->table[h];
+
+		s->table[h] = ip;
+		if (cand < ip && read32 (src + cand) == v) {
+			size_t len = LZ_MIN_MATCH;
+
+			while (ip + len < src_size && src[cand + len] == src[ip + len])
+				len++;
+			if (!put_sequence (&op, end, src + anchor, ip - anchor,
+						ip - cand, len))
+				return 0;
+			ip += len;
+			anchor = ip;
+		} else
+			ip++;
+	}
+
+	if (!put_sequence (&op, end, src + anchor, src_size - anchor, 0, 0))
+		return 0;
+	return op - dst;
+}
+
+/* Adds to *LEN the extra length bytes at *IP, which must stay
+   below END.  Returns false if the input ends first. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *end, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip >= end)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Decompresses the SRC_SIZE bytes at SRC, produced by
+   lz_compress(), into DST.  Returns the decompressed size, or
+   SIZE_MAX if the input is malformed or would decompress to more
+   than DST_CAP bytes. */
+size_t
+lz_decompress (const void *src, size_t src_size, void *dst_, size_t dst_cap) {
+	const uint8_t *ip = src;
+	const uint8_t *ip_end = ip + src_size;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint8_t *op_end = dst + dst_cap;
+
+	while (ip < ip_end) {
+		unsigned token = *ip++;
+		size_t lit_len = token >> 4;
+		size_t match_len = token & 15;
+		const uint8_t *match;
+		size_t offset;
+
+		if (lit_len == 15 && !get_length (&ip, ip_end, &lit_len))
+			return SIZE_MAX;
+		if ((size_t) (ip_end - ip) < lit_len
+				|| (size_t) (op_end - op) < lit_len)
+			return SIZE_MAX;
+		memcpy (op, ip, lit_len);
+		op += lit_len;
+		ip += lit_len;
+		if (ip == ip_end)
+			break;
+
+		if (ip_end - ip < 2)
+			return SIZE_MAX;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		if (match_len == 15 && !get_length (&ip, ip_end, &match_len))
+			return SIZE_MAX;
+		match_len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| (size_t) (op_end - op) < match_len)
+			return SIZE_MAX;
+
+		/* Byte by byte: the match may overlap what it produces. */
+		match = op - offset;
+		while (match_len-- > 0)
+			*op++ = *match++;
+	}
+	return op - dst;
+}
@@ -0,0 +1,68 @@
+/* Sleeps for 500 microseconds 20 times while a lower-priority
+   thread spins.  Checks that each sleep lasted at least as long
+   as requested, according to timer_ns(), and that the spinning
+   thread got to run while we slept, which it cannot if the sleep
+   busy-waits.  Also reports the average time overslept. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_CNT 20
+#define SLEEP_US 500
+
+/* Shared with the spinner.  The test waits on SPINNER_DONE for
+   the spinner to finish before returning. */
+static volatile int64_t spins;
+static volatile bool done;
+static struct semaphore spinner_done;
+
+static thread_func spinner;
+
+void
+test_alarm_hrtimer (void) 
+{
+  uint64_t overslept = 0;
+  int short_cnt = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  spins = 0;
+  done = false;
+  sema_init (&spinner_done, 0);
+  thread_create ("spinner", PRI_DEFAULT - 1, spinner, NULL);
+
+  for (i = 0; i < SLEEP_CNT; i++) 
+    {
+      uint64_t start = timer_ns ();
+      uint64_t slept;
+
+      timer_usleep (SLEEP_US);
+      slept = timer_ns () - start;
+      if (slept < SLEEP_US * 1000)
+        short_cnt++;
+      else
+        overslept += slept - SLEEP_US * 1000;
+    }
+  done = true;
+  sema_down (&spinner_done);
+
+  msg ("Slept %d times for %d us, %d of them too short.",
+       SLEEP_CNT, SLEEP_US, short_cnt);
+  msg ("Other thread ran while we slept: %s.", spins > 0 ? "yes" : "no");
+  msg ("Overslept %"PRIu64" ns on average.", overslept / SLEEP_CNT);
+}
+
+static void
+spinner (void *aux UNUSED) 
+{
+  while (!done)
+    spins++;
+  sema_up (&spinner_done);
+}
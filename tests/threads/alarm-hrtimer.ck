@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/Overslept \d+ ns on average\.$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-hrtimer) begin
+(alarm-hrtimer) Slept 20 times for 500 us, 0 of them too short.
+(alarm-hrtimer) Other thread ran while we slept: yes.
+(alarm-hrtimer) end
+EOF
+pass;
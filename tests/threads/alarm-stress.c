@@ -0,0 +1,93 @@
+/* Creates 5,000 threads, each of which sleeps a different
+   duration a few times, and verifies that every thread wakes up
+   no earlier than requested.  Also reports how many TSC cycles
+   the timer interrupt handler spent while the sleepers were
+   running, which should not grow with the number of sleepers. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 5000
+#define ITERATIONS 3
+
+/* Information shared between all sleepers. */
+struct stress_test 
+  {
+    struct semaphore done;      /* Upped once per finished thread. */
+    struct lock lock;           /* Protects early_wakeups. */
+    int early_wakeups;          /* # of wakeups before the deadline. */
+  };
+
+static struct stress_test test;
+
+static void sleeper (void *);
+
+void
+test_alarm_stress (void) 
+{
+  int64_t start_ticks;
+  uint64_t start_cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep %d times each.",
+       THREAD_CNT, ITERATIONS);
+
+  sema_init (&test.done, 0);
+  lock_init (&test.lock);
+  test.early_wakeups = 0;
+
+  start_ticks = timer_ticks ();
+  start_cycles = timer_intr_cycles ();
+
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper,
+                         (void *) (intptr_t) i) == TID_ERROR)
+        fail ("thread_create failed at thread %d", i);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test.done);
+
+  msg ("All %d threads woke up %d times.", THREAD_CNT, ITERATIONS);
+  if (test.early_wakeups != 0)
+    fail ("%d wakeups happened before their deadline", test.early_wakeups);
+
+  /* Not checked by the grader, only reported. */
+  msg ("Timer interrupt: %llu cycles over %lld ticks.",
+       (unsigned long long) (timer_intr_cycles () - start_cycles),
+       (long long) timer_elapsed (start_ticks));
+  pass ();
+}
+
+/* Sleeper thread.  Sleeps 1 to 97 ticks, ITERATIONS times. */
+static void
+sleeper (void *id_) 
+{
+  int id = (intptr_t) id_;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      int64_t duration = (id * 7 + i * 13) % 97 + 1;
+      int64_t wakeup = timer_ticks () + duration;
+
+      timer_sleep (duration);
+      if (timer_ticks () < wakeup) 
+        {
+          lock_acquire (&test.lock);
+          test.early_wakeups++;
+          lock_release (&test.lock);
+        }
+    }
+  sema_up (&test.done);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/Timer interrupt: \d+ cycles over \d+ ticks\.$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-stress) begin
+(alarm-stress) Creating 5000 threads to sleep 3 times each.
+(alarm-stress) All 5000 threads woke up 3 times.
+(alarm-stress) PASS
+(alarm-stress) end
+EOF
+pass;
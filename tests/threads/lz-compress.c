@@ -0,0 +1,86 @@
+/* Compresses pages with different contents, as zswap sees them,
+   and checks that each one decompresses to what it was.  Pages
+   full of zeros or text must shrink to less than half a page;
+   random bytes must be reported as not fitting in a page. */
+
+#include <stdio.h>
+#include <random.h>
+#include <string.h>
+#include <lz.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+enum fill { FILL_ZERO, FILL_TEXT, FILL_SPARSE, FILL_RANDOM, FILL_CNT };
+
+static const char *fill_names[FILL_CNT] = {
+  "zero", "text", "sparse", "random",
+};
+
+static struct lz_state state;
+
+static void fill_page (uint8_t *page, enum fill);
+
+void
+test_lz_compress (void)
+{
+  uint8_t *src = palloc_get_page (PAL_ASSERT);
+  uint8_t *cmp = palloc_get_page (PAL_ASSERT);
+  uint8_t *out = palloc_get_page (PAL_ASSERT);
+  enum fill f;
+
+  random_init (0);
+  for (f = 0; f < FILL_CNT; f++)
+    {
+      size_t cmp_size, out_size;
+
+      fill_page (src, f);
+      cmp_size = lz_compress (&state, src, PGSIZE, cmp, PGSIZE);
+      if (cmp_size == 0)
+        {
+          msg ("%s page: does not fit in a page.", fill_names[f]);
+          continue;
+        }
+
+      memset (out, 0xcc, PGSIZE);
+      out_size = lz_decompress (cmp, cmp_size, out, PGSIZE);
+      msg ("%s page: round trip %s, less than half a page: %s.",
+           fill_names[f],
+           out_size == PGSIZE && !memcmp (src, out, PGSIZE) ? "ok" : "FAILED",
+           cmp_size < PGSIZE / 2 ? "yes" : "no");
+    }
+
+  palloc_free_page (src);
+  palloc_free_page (cmp);
+  palloc_free_page (out);
+}
+
+/* Fills PAGE according to F. */
+static void
+fill_page (uint8_t *page, enum fill f)
+{
+  static const char text[] = "It was the best of times, it was the worst of times. ";
+  size_t i;
+
+  switch (f)
+    {
+    case FILL_ZERO:
+      memset (page, 0, PGSIZE);
+      break;
+    case FILL_TEXT:
+      for (i = 0; i < PGSIZE; i++)
+        page[i] = text[i % (sizeof text - 1)];
+      break;
+    case FILL_SPARSE:
+      /* Mostly zeros with a few scattered words, like a page of a
+         sparsely used array. */
+      memset (page, 0, PGSIZE);
+      for (i = 0; i < PGSIZE; i += 64 + random_ulong () % 128)
+        page[i] = random_ulong ();
+      break;
+    default:
+      random_bytes (page, PGSIZE);
+      break;
+    }
+}
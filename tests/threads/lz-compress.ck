@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lz-compress) begin
+(lz-compress) zero page: round trip ok, less than half a page: yes.
+(lz-compress) text page: round trip ok, less than half a page: yes.
+(lz-compress) sparse page: round trip ok, less than half a page: yes.
+(lz-compress) random page: does not fit in a page.
+(lz-compress) end
+EOF
+pass;
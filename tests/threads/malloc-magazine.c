@@ -0,0 +1,119 @@
+/* Runs several threads that malloc() and free() blocks of random
+   small sizes, checking that no block is handed out twice or
+   corrupted while it is in use.  Each thread leaves some blocks
+   allocated when it exits, and the main thread frees them, so
+   blocks also move between threads' magazines. */
+
+#include <stdio.h>
+#include <random.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 4
+#define SLOT_CNT 16
+#define ITER_CNT 2000
+
+struct slot
+  {
+    unsigned char *block;
+    size_t size;
+    unsigned char fill;
+  };
+
+struct worker
+  {
+    int id;
+    struct slot slots[SLOT_CNT];
+    bool intact;
+    struct semaphore done;
+  };
+
+static thread_func worker_func;
+static bool check_slot (const struct slot *);
+
+void
+test_malloc_magazine (void)
+{
+  static struct worker workers[THREAD_CNT];
+  bool intact = true;
+  int i, j;
+
+  random_init (0);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      workers[i].id = i;
+      workers[i].intact = true;
+      memset (workers[i].slots, 0, sizeof workers[i].slots);
+      sema_init (&workers[i].done, 0);
+      snprintf (name, sizeof name, "worker %d", i);
+      thread_create (name, PRI_DEFAULT, worker_func, &workers[i]);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      sema_down (&workers[i].done);
+      if (!workers[i].intact)
+        intact = false;
+
+      /* Free what the worker left behind. */
+      for (j = 0; j < SLOT_CNT; j++)
+        if (workers[i].slots[j].block != NULL)
+          {
+            if (!check_slot (&workers[i].slots[j]))
+              intact = false;
+            free (workers[i].slots[j].block);
+          }
+    }
+  msg ("%d threads did %d allocations and frees each.",
+       THREAD_CNT, ITER_CNT);
+  msg ("Blocks intact: %s.", intact ? "yes" : "no");
+}
+
+static void
+worker_func (void *w_)
+{
+  struct worker *w = w_;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      struct slot *s = &w->slots[random_ulong () % SLOT_CNT];
+
+      if (s->block != NULL)
+        {
+          if (!check_slot (s))
+            w->intact = false;
+          free (s->block);
+          s->block = NULL;
+        }
+      else
+        {
+          s->size = random_ulong () % 1024 + 1;
+          s->fill = w->id * SLOT_CNT + (s - w->slots);
+          s->block = malloc (s->size);
+          if (s->block == NULL)
+            w->intact = false;
+          else
+            memset (s->block, s->fill, s->size);
+        }
+    }
+  sema_up (&w->done);
+}
+
+/* Returns true if S's block still holds its fill pattern. */
+static bool
+check_slot (const struct slot *s)
+{
+  size_t i;
+
+  for (i = 0; i < s->size; i++)
+    if (s->block[i] != s->fill)
+      return false;
+  return true;
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-magazine) begin
+(malloc-magazine) 4 threads did 2000 allocations and frees each.
+(malloc-magazine) Blocks intact: yes.
+(malloc-magazine) end
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Allocates runs of pages of assorted sizes from the kernel pool,
+   checks that no two runs overlap, then frees them in a different
+   order than they were allocated.  The buddy allocator should
+   merge everything back, leaving exactly the free blocks it had
+   before the test started. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define RUN_CNT 48
+
+static const size_t run_sizes[] = {1, 3, 8, 5, 1, 16, 2, 33, 7, 1, 64, 4};
+
+static bool counts_equal (const size_t a[], const size_t b[]);
+
+void
+test_palloc_buddy (void)
+{
+  size_t before[PALLOC_ORDER_CNT], after[PALLOC_ORDER_CNT];
+  uint8_t *runs[RUN_CNT];
+  size_t sizes[RUN_CNT];
+  bool intact = true;
+  int i;
+
+  palloc_get_free_counts (0, before);
+
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      sizes[i] = run_sizes[i % (sizeof run_sizes / sizeof *run_sizes)];
+      runs[i] = palloc_get_multiple (PAL_ASSERT, sizes[i]);
+      memset (runs[i], i, sizes[i] * PGSIZE);
+    }
+  msg ("Allocated %d runs of pages.", RUN_CNT);
+
+  /* Each run must still hold its own pattern. */
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      size_t ofs;
+
+      for (ofs = 0; ofs < sizes[i] * PGSIZE; ofs += 512)
+        if (runs[i][ofs] != i)
+          intact = false;
+    }
+  msg ("Runs do not overlap: %s.", intact ? "yes" : "no");
+
+  /* Free the odd runs first, then the even ones backward, so that
+     most blocks are freed before their buddies. */
+  for (i = 1; i < RUN_CNT; i += 2)
+    palloc_free_multiple (runs[i], sizes[i]);
+  for (i = RUN_CNT - 2; i >= 0; i -= 2)
+    palloc_free_multiple (runs[i], sizes[i]);
+
+  palloc_get_free_counts (0, after);
+  msg ("Free blocks restored after freeing: %s.",
+       counts_equal (before, after) ? "yes" : "no");
+}
+
+/* Returns true if free block counts A and B are the same. */
+static bool
+counts_equal (const size_t a[], const size_t b[])
+{
+  int k;
+
+  for (k = 0; k < PALLOC_ORDER_CNT; k++)
+    if (a[k] != b[k])
+      return false;
+  return true;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-buddy) begin
+(palloc-buddy) Allocated 48 runs of pages.
+(palloc-buddy) Runs do not overlap: yes.
+(palloc-buddy) Free blocks restored after freeing: yes.
+(palloc-buddy) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Checks pages that the idle thread zeroes in advance.  Sleeps so
+   that the idle thread gets to run, then allocates zeroed pages,
+   which should mostly come ready-made and thus be much cheaper,
+   and checks that every one of them is really all zeros.  Then
+   dirties and frees them and does it again. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define PAGE_CNT 32
+
+static bool all_zero (const uint64_t *page);
+
+void
+test_palloc_prezero (void)
+{
+  uint64_t *pages[PAGE_CNT];
+  int round, i;
+
+  for (round = 0; round < 2; round++)
+    {
+      uint64_t start, cycles;
+      bool zero = true;
+
+      /* Give the idle thread time to zero pages. */
+      timer_sleep (5);
+
+      start = rdtsc ();
+      for (i = 0; i < PAGE_CNT; i++)
+        pages[i] = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+      cycles = rdtsc () - start;
+
+      for (i = 0; i < PAGE_CNT; i++)
+        {
+          if (!all_zero (pages[i]))
+            zero = false;
+          pages[i][i] = 0xdeadbeef;
+        }
+      msg ("Round %d: %d zeroed pages are all zeros: %s.",
+           round, PAGE_CNT, zero ? "yes" : "no");
+      msg ("Round %d: %llu cycles per PAL_ZERO page.",
+           round, (unsigned long long) (cycles / PAGE_CNT));
+
+      for (i = 0; i < PAGE_CNT; i++)
+        palloc_free_page (pages[i]);
+    }
+}
+
+/* Returns true if PAGE holds only zeros. */
+static bool
+all_zero (const uint64_t *page)
+{
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *page; i++)
+    if (page[i] != 0)
+      return false;
+  return true;
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/cycles per PAL_ZERO page\.$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-prezero) begin
+(palloc-prezero) Round 0: 32 zeroed pages are all zeros: yes.
+(palloc-prezero) Round 1: 32 zeroed pages are all zeros: yes.
+(palloc-prezero) end
+EOF
+pass;
@@ -0,0 +1,106 @@
+/* The main thread acquires a lock and then lets 1, 16 and 128
+   higher-priority threads block on it.  Checks that the main
+   thread receives the donation, and that the waiters get the
+   lock in FIFO order once it is released.  Also reports the
+   average number of TSC cycles needed to pass the lock from one
+   holder to the next.  That cost should not grow with the number
+   of waiters. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Information shared between the main thread and the waiters. */
+struct many_test 
+  {
+    struct lock lock;           /* Lock everyone waits on. */
+    int next;                   /* ID expected to acquire next. */
+    int out_of_order;           /* # of waiters acquired out of order. */
+    uint64_t start;             /* TSC when the main thread released. */
+    uint64_t end;               /* TSC when the last waiter acquired. */
+  };
+
+/* Information about one waiter. */
+struct waiter_data 
+  {
+    struct many_test *test;     /* Shared test information. */
+    int id;                     /* Order of arrival on the lock. */
+  };
+
+static thread_func waiter;
+static void run_waiters (int waiter_cnt);
+
+void
+test_priority_donate_many (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  run_waiters (1);
+  run_waiters (16);
+  run_waiters (128);
+}
+
+static void
+run_waiters (int waiter_cnt) 
+{
+  struct many_test test;
+  struct waiter_data *data;
+  int i;
+
+  data = malloc (sizeof *data * waiter_cnt);
+  if (data == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  lock_init (&test.lock);
+  test.next = 0;
+  test.out_of_order = 0;
+  lock_acquire (&test.lock);
+
+  for (i = 0; i < waiter_cnt; i++) 
+    {
+      char name[32];
+      data[i].test = &test;
+      data[i].id = i;
+      snprintf (name, sizeof name, "waiter %d", i);
+      thread_create (name, PRI_DEFAULT + 1, waiter, &data[i]);
+    }
+  if (thread_get_priority () != PRI_DEFAULT + 1)
+    fail ("main thread should have priority %d, actual priority %d",
+          PRI_DEFAULT + 1, thread_get_priority ());
+
+  test.start = rdtsc ();
+  lock_release (&test.lock);
+
+  /* All the waiters have higher priority, so they are done by the
+     time we run again. */
+  msg ("%d waiters acquired the lock in FIFO order: %s.",
+       waiter_cnt, test.next == waiter_cnt && test.out_of_order == 0
+       ? "yes" : "no");
+  msg ("%d waiters: %llu cycles per handoff.", waiter_cnt,
+       (unsigned long long) ((test.end - test.start) / waiter_cnt));
+  free (data);
+}
+
+static void
+waiter (void *data_) 
+{
+  struct waiter_data *data = data_;
+  struct many_test *test = data->test;
+
+  /* Each waiter blocks on the lock as soon as it is created, so
+     its ID is its arrival order. */
+  lock_acquire (&test->lock);
+  test->end = rdtsc ();
+  if (data->id != test->next)
+    test->out_of_order++;
+  test->next++;
+  lock_release (&test->lock);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/waiters: \d+ cycles per handoff\.$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(priority-donate-many) begin
+(priority-donate-many) 1 waiters acquired the lock in FIFO order: yes.
+(priority-donate-many) 16 waiters acquired the lock in FIFO order: yes.
+(priority-donate-many) 128 waiters acquired the lock in FIFO order: yes.
+(priority-donate-many) end
+EOF
+pass;
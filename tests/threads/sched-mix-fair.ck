@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+my (@ticks, @wakeups, @late);
+foreach (@output) {
+    $ticks[$1] = $2 if /CPU thread (\d+) \(nice \d+\) received (\d+) ticks\./;
+    ($wakeups[$1], $late[$1]) = ($2, $3)
+      if /I\/O thread (\d+) woke up (\d+) times, (\d+) ticks late/;
+}
+fail "missing CPU thread results\n" if grep (!defined, @ticks[0, 1]);
+fail "missing I/O thread results\n" if grep (!defined, @wakeups[0, 1]);
+
+# Weights 1024 and 335 give the nice 0 thread about 3 times the
+# ticks of the nice 5 thread.
+fail "nice 5 thread starved\n" if $ticks[1] == 0;
+my ($ratio) = $ticks[0] / $ticks[1];
+fail sprintf ("nice 0 thread got %.2f times the ticks of the nice 5 "
+	      . "thread, expected about 3\n", $ratio)
+  if $ratio < 2 || $ratio > 4.5;
+
+# Sleepers must not wait behind the CPU-bound threads.
+for my $i (0, 1) {
+    fail "I/O thread $i never woke up\n" if $wakeups[$i] == 0;
+    fail "I/O thread $i was on average more than a tick late\n"
+      if $late[$i] > $wakeups[$i];
+}
+pass;
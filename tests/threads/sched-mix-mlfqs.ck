@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+# The MLFQS run is for comparison with sched-mix-fair; only check
+# that nobody starved.
+my (@ticks, @wakeups);
+foreach (@output) {
+    $ticks[$1] = $2 if /CPU thread (\d+) \(nice \d+\) received (\d+) ticks\./;
+    $wakeups[$1] = $2 if /I\/O thread (\d+) woke up (\d+) times/;
+}
+for my $i (0, 1) {
+    fail "CPU thread $i starved\n" if !$ticks[$i];
+    fail "I/O thread $i never woke up\n" if !$wakeups[$i];
+}
+pass;
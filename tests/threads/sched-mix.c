@@ -0,0 +1,154 @@
+/* Runs a mix of CPU-bound and I/O-bound threads for 10 seconds
+   and reports how the scheduler treated them, so that the fair
+   scheduler and the MLFQS can be compared on the same load.
+
+   Two CPU-bound threads spin, one at nice 0 and one at nice 5.
+   Each counts the timer ticks during which it was running, which
+   measures fairness, and the loop iterations it completed, which
+   measures throughput.  Two I/O-bound threads repeatedly sleep
+   for one tick and report how many ticks late they got to run
+   after their wakeup tick.
+
+   sched-mix-fair runs under "-fair", where the nice 0 thread
+   should get about 1024 / 335, or 3 times, the ticks of the nice
+   5 thread.  sched-mix-mlfqs runs the same load under "-mlfqs"
+   for comparison. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define CPU_CNT 2
+#define IO_CNT 2
+#define START_DELAY (1 * TIMER_FREQ)   /* Ticks before threads start. */
+#define RUN_TIME (10 * TIMER_FREQ)     /* Ticks that threads run. */
+
+struct cpu_info
+  {
+    int64_t start_time;
+    int nice;
+    int tick_count;
+    uint64_t iterations;
+  };
+
+struct io_info
+  {
+    int64_t start_time;
+    int wakeups;
+    int64_t late_ticks;
+    int64_t max_late;
+  };
+
+static thread_func cpu_thread;
+static thread_func io_thread;
+static void test_sched_mix (void);
+
+void
+test_sched_mix_fair (void)
+{
+  ASSERT (thread_fair);
+  test_sched_mix ();
+}
+
+void
+test_sched_mix_mlfqs (void)
+{
+  ASSERT (thread_mlfqs);
+  test_sched_mix ();
+}
+
+static void
+test_sched_mix (void)
+{
+  struct cpu_info cpu[CPU_CNT];
+  struct io_info io[IO_CNT];
+  uint64_t total = 0;
+  int64_t start_time;
+  int i;
+
+  /* Make sure the main thread gets to create everything. */
+  thread_set_nice (-20);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d CPU-bound and %d I/O-bound threads...",
+       CPU_CNT, IO_CNT);
+  for (i = 0; i < CPU_CNT; i++)
+    {
+      char name[16];
+
+      cpu[i].start_time = start_time;
+      cpu[i].nice = i * 5;
+      cpu[i].tick_count = 0;
+      cpu[i].iterations = 0;
+      snprintf (name, sizeof name, "cpu %d", i);
+      thread_create (name, PRI_DEFAULT, cpu_thread, &cpu[i]);
+    }
+  for (i = 0; i < IO_CNT; i++)
+    {
+      char name[16];
+
+      io[i].start_time = start_time;
+      io[i].wakeups = 0;
+      io[i].late_ticks = 0;
+      io[i].max_late = 0;
+      snprintf (name, sizeof name, "io %d", i);
+      thread_create (name, PRI_DEFAULT, io_thread, &io[i]);
+    }
+
+  msg ("Sleeping 12 seconds to let threads run, please wait...");
+  timer_sleep (START_DELAY + RUN_TIME + TIMER_FREQ);
+
+  for (i = 0; i < CPU_CNT; i++)
+    {
+      msg ("CPU thread %d (nice %d) received %d ticks.",
+           i, cpu[i].nice, cpu[i].tick_count);
+      total += cpu[i].iterations;
+    }
+  msg ("CPU threads completed %"PRIu64" iterations.", total);
+  for (i = 0; i < IO_CNT; i++)
+    msg ("I/O thread %d woke up %d times, "
+         "%"PRId64" ticks late in total, at most %"PRId64".",
+         i, io[i].wakeups, io[i].late_ticks, io[i].max_late);
+}
+
+static void
+cpu_thread (void *info_)
+{
+  struct cpu_info *info = info_;
+  int64_t last_time = 0;
+
+  thread_set_nice (info->nice);
+  timer_sleep (START_DELAY - timer_elapsed (info->start_time));
+  while (timer_elapsed (info->start_time) < START_DELAY + RUN_TIME)
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        info->tick_count++;
+      last_time = cur_time;
+      info->iterations++;
+    }
+}
+
+static void
+io_thread (void *info_)
+{
+  struct io_info *info = info_;
+
+  timer_sleep (START_DELAY - timer_elapsed (info->start_time));
+  while (timer_elapsed (info->start_time) < START_DELAY + RUN_TIME)
+    {
+      int64_t wakeup = timer_ticks () + 1;
+      int64_t late;
+
+      timer_sleep (1);
+      late = timer_ticks () - wakeup;
+      info->wakeups++;
+      info->late_ticks += late;
+      if (late > info->max_late)
+        info->max_late = late;
+    }
+}
@@ -0,0 +1,98 @@
+/* Exercises an object cache with a constructor.  Allocates enough
+   objects to fill several slabs, checks that they were all
+   constructed and do not overlap, frees them and allocates them
+   again: reused objects must come back in their constructed
+   state, without the constructor running again. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 200
+#define OBJ_MAGIC 0x0b1ec7
+
+struct obj
+  {
+    int magic;          /* Set by the constructor. */
+    int owner;          /* Index of the allocation that holds it. */
+    char data[92];
+  };
+
+static int ctor_cnt;
+
+static void obj_ctor (void *);
+static bool alloc_all (struct kmem_cache *, struct obj *objs[]);
+
+void
+test_slab_cache (void)
+{
+  struct kmem_cache *cache;
+  struct obj *objs[OBJ_CNT];
+  int first_ctor_cnt;
+  int i;
+
+  cache = kmem_cache_create ("slab-cache test", sizeof (struct obj),
+                             obj_ctor);
+
+  msg ("First pass ok: %s.", alloc_all (cache, objs) ? "yes" : "no");
+  first_ctor_cnt = ctor_cnt;
+  msg ("Constructed at least %d objects: %s.", OBJ_CNT,
+       first_ctor_cnt >= OBJ_CNT ? "yes" : "no");
+
+  /* Free in reverse order, leaving each object's magic intact. */
+  for (i = OBJ_CNT - 1; i >= 0; i--)
+    kmem_cache_free (cache, objs[i]);
+
+  msg ("Second pass ok: %s.", alloc_all (cache, objs) ? "yes" : "no");
+
+  /* Slabs that were given back to the page allocator must be
+     constructed again, but not those that were kept. */
+  msg ("Constructor ran less often the second time: %s.",
+       ctor_cnt - first_ctor_cnt < first_ctor_cnt ? "yes" : "no");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (cache, objs[i]);
+}
+
+static void
+obj_ctor (void *obj_)
+{
+  struct obj *obj = obj_;
+
+  obj->magic = OBJ_MAGIC;
+  obj->owner = -1;
+  ctor_cnt++;
+}
+
+/* Allocates OBJ_CNT objects from CACHE into OBJS and returns
+   true if all of them were constructed and none overlap. */
+static bool
+alloc_all (struct kmem_cache *cache, struct obj *objs[])
+{
+  bool ok = true;
+  int i;
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      objs[i] = kmem_cache_alloc (cache);
+      if (objs[i] == NULL || objs[i]->magic != OBJ_MAGIC)
+        return false;
+      objs[i]->owner = i;
+      memset (objs[i]->data, i, sizeof objs[i]->data);
+    }
+
+  for (i = 0; i < OBJ_CNT; i++)
+    {
+      size_t j;
+
+      if (objs[i]->magic != OBJ_MAGIC || objs[i]->owner != i)
+        ok = false;
+      for (j = 0; j < sizeof objs[i]->data; j++)
+        if (objs[i]->data[j] != (char) i)
+          ok = false;
+      objs[i]->owner = -1;
+    }
+  return ok;
+}
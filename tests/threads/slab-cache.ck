@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-cache) begin
+(slab-cache) First pass ok: yes.
+(slab-cache) Constructed at least 200 objects: yes.
+(slab-cache) Second pass ok: yes.
+(slab-cache) Constructor ran less often the second time: yes.
+(slab-cache) end
+EOF
+pass;
@@ -0,0 +1,56 @@
+/* Creates batches of short-lived threads and reports the average
+   number of TSC cycles that thread_create() takes in each batch.
+   The first batch has to get its pages from the page allocator;
+   later batches should reuse the pages of the threads that died
+   in the batch before, which is noticeably cheaper.  Also checks
+   that every thread ran. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+#define BATCH_CNT 4
+#define THREAD_CNT 32
+
+static thread_func spawned;
+
+void
+test_thread_spawn (void) 
+{
+  struct semaphore done;
+  int batch, i;
+
+  sema_init (&done, 0);
+  for (batch = 0; batch < BATCH_CNT; batch++) 
+    {
+      uint64_t start, cycles;
+
+      /* The new threads have the same priority as us, so none of
+         them runs until we wait for them below. */
+      start = rdtsc ();
+      for (i = 0; i < THREAD_CNT; i++)
+        thread_create ("spawned", PRI_DEFAULT, spawned, &done);
+      cycles = rdtsc () - start;
+
+      for (i = 0; i < THREAD_CNT; i++)
+        sema_down (&done);
+
+      /* Let the last thread to exit be reaped. */
+      thread_yield ();
+
+      msg ("Batch %d: %d threads ran.", batch + 1, THREAD_CNT);
+      msg ("Batch %d: %llu cycles per thread_create.", batch + 1,
+           (unsigned long long) (cycles / THREAD_CNT));
+    }
+}
+
+static void
+spawned (void *done_) 
+{
+  struct semaphore *done = done_;
+
+  sema_up (done);
+}
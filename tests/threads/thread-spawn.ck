@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/cycles per thread_create\.$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(thread-spawn) begin
+(thread-spawn) Batch 1: 32 threads ran.
+(thread-spawn) Batch 2: 32 threads ran.
+(thread-spawn) Batch 3: 32 threads ran.
+(thread-spawn) Batch 4: 32 threads ran.
+(thread-spawn) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Forks batches of children that exit at once, waiting for each,
+   and reports the average number of TSC cycles that one
+   fork-exit-wait round takes in each batch.  The first batch gets
+   its thread pages from the page allocator; later batches should
+   reuse those of the children that died in the batch before.
+   Also checks that every child exited with the right status. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BATCH_CNT 4
+#define CHILD_CNT 16
+
+/* Reads the time-stamp counter, which user code may read too. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+void
+test_main (void) 
+{
+  int batch, i;
+
+  for (batch = 0; batch < BATCH_CNT; batch++) 
+    {
+      uint64_t start, cycles;
+      int ok = 0;
+
+      start = rdtsc ();
+      for (i = 0; i < CHILD_CNT; i++)
+        {
+          pid_t pid = fork ("child");
+          if (pid == 0)
+            exit (i);
+          if (pid > 0 && wait (pid) == i)
+            ok++;
+        }
+      cycles = rdtsc () - start;
+
+      msg ("Batch %d: %d of %d children exited.", batch + 1, ok, CHILD_CNT);
+      msg ("Batch %d: %llu cycles per fork-exit-wait.", batch + 1,
+           (unsigned long long) (cycles / CHILD_CNT));
+    }
+}
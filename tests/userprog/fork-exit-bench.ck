@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/cycles per fork-exit-wait\.$/ && !/^child: exit\(\d+\)$/,
+		@output);
+compare_output ("run", \@output, [<<'EOF']);
+(fork-exit-bench) begin
+(fork-exit-bench) Batch 1: 16 of 16 children exited.
+(fork-exit-bench) Batch 2: 16 of 16 children exited.
+(fork-exit-bench) Batch 3: 16 of 16 children exited.
+(fork-exit-bench) Batch 4: 16 of 16 children exited.
+(fork-exit-bench) end
+fork-exit-bench: exit(0)
+EOF
+pass;
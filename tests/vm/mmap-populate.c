@@ -0,0 +1,39 @@
+/* Maps a file with MAP_POPULATE and checks that every page of the
+   mapping is loaded before it is touched, and holds the right data. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/small.inc"
+
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  size_t size = sizeof small - 1;
+  size_t page_cnt = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+  int handle;
+  void *map;
+  size_t i;
+
+  CHECK ((handle = open ("small.txt")) > 1, "open \"small.txt\"");
+  CHECK ((map = mmap (actual, page_cnt * PAGE_SIZE, MAP_POPULATE,
+                      handle, 0)) != MAP_FAILED,
+         "mmap \"small.txt\" with MAP_POPULATE");
+
+  /* Every page must be loaded without having been touched. */
+  for (i = 0; i < page_cnt; i++)
+    if (get_phys_addr (actual + i * PAGE_SIZE) == 0)
+      fail ("page %zu of the mapping is not loaded", i);
+  msg ("all %zu pages loaded", page_cnt);
+
+  if (memcmp (actual, small, size))
+    fail ("read of mmap'd file reported bad data");
+
+  munmap (map);
+  close (handle);
+}
@@ -1,6 +1,7 @@
 #include "threads/init.h"
 #include <console.h>
 #include <debug.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <random.h>
 #include <stddef.h>
@@ -20,7 +21,10 @@
 #include "threads/mmu.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/schedtrace.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -31,6 +35,7 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -51,6 +56,16 @@ bool power_off_when_done;
 
 bool thread_tests;
 
+/* Boot phases, each recorded with the TSC at its end by
+   boot_phase(), so that slow startup steps stand out. */
+#define BOOT_PHASE_MAX 24
+static struct {
+	const char *name;
+	uint64_t tsc;
+} boot_phases[BOOT_PHASE_MAX];
+static size_t boot_phase_cnt;
+static uint64_t boot_start_tsc;
+
 static void bss_init (void);
 static void paging_init (uint64_t mem_end);
 
@@ -59,6 +74,8 @@ static char **parse_options (char **argv);
 static void run_actions (char **argv);
 static void usage (void);
 
+static void boot_phase (const char *name);
+static void print_boot_phases (void);
 static void print_stats (void);
 
 
@@ -72,24 +89,31 @@ main (void) {
 
 	/* Clear BSS and get machine's RAM size. */
 	bss_init ();
+	boot_start_tsc = rdtsc ();
 
 	/* Break command line into arguments and parse options. */
 	argv = read_command_line ();
 	argv = parse_options (argv);
+	boot_phase ("parse_options");
 
 	/* Initialize ourselves as a thread so we can use locks,
 	   then enable console locking. */
 	thread_init ();
 	console_init ();
+	boot_phase ("thread_init");
 
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
+	boot_phase ("palloc_init");
 	malloc_init ();
+	boot_phase ("malloc_init");
 	paging_init (mem_end);
+	boot_phase ("paging_init");
 
 #ifdef USERPROG
 	tss_init ();
 	gdt_init ();
+	boot_phase ("gdt_init");
 #endif
 
 	/* Initialize interrupt handlers. */
@@ -101,21 +125,28 @@ main (void) {
 	exception_init ();
 	syscall_init ();
 #endif
+	boot_phase ("intr_init");
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
 	serial_init_queue ();
+	boot_phase ("thread_start");
 	timer_calibrate ();
+	boot_phase ("timer_calibrate");
 
 #ifdef FILESYS
 	/* Initialize file system. */
 	disk_init ();
+	boot_phase ("disk_init");
 	filesys_init (format_filesys);
+	boot_phase ("filesys_init");
 #endif
 
 #ifdef VM
 	vm_init ();
+	boot_phase ("vm_init");
 #endif
 
+	print_boot_phases ();
 	printf ("Boot complete.\n");
 
 	/* Run actions specified on kernel command line. */
@@ -200,6 +231,36 @@ read_command_line (void) {
 	return argv;
 }
 
+/* Records the end of boot phase NAME. */
+static void
+boot_phase (const char *name) {
+	if (boot_phase_cnt < BOOT_PHASE_MAX) {
+		boot_phases[boot_phase_cnt].name = name;
+		boot_phases[boot_phase_cnt].tsc = rdtsc ();
+		boot_phase_cnt++;
+	}
+}
+
+/* Prints how long each boot phase took.  The TSC is only
+   calibrated partway through boot, so the phases are recorded
+   in cycles and converted here. */
+static void
+print_boot_phases (void) {
+	uint64_t prev = boot_start_tsc;
+	size_t i;
+
+	printf ("Boot phases:");
+	for (i = 0; i < boot_phase_cnt; i++) {
+		printf (" %s %'"PRIu64" us%s", boot_phases[i].name,
+				timer_cycles_to_ns (boot_phases[i].tsc - prev) / 1000,
+				i + 1 < boot_phase_cnt ? "," : "");
+		prev = boot_phases[i].tsc;
+	}
+	printf (".\n");
+	printf ("Boot took %'"PRIu64" us.\n",
+			timer_cycles_to_ns (prev - boot_start_tsc) / 1000);
+}
+
 /* Parses options in ARGV[]
    and returns the first non-option argument. */
 static char **
@@ -221,16 +282,33 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-fair"))
+			thread_fair = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-lpj"))
+			timer_lpj = atoi (value);
+		else if (!strcmp (name, "-sched-trace"))
+			sched_trace_enabled = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-zswap"))
+			zswap_enabled = true;
+		else if (!strcmp (name, "-fault-around"))
+			fault_around_pages = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
 
+	if (thread_mlfqs && thread_fair)
+		PANIC ("-mlfqs and -fair cannot be used together");
+
 	return argv;
 }
 
@@ -272,6 +350,7 @@ run_actions (char **argv) {
 		{"rm", 2, fsutil_rm},
 		{"put", 2, fsutil_put},
 		{"get", 2, fsutil_get},
+		{"savetrace", 2, sched_trace_save},
 #endif
 		{NULL, 0, NULL},
 	};
@@ -319,6 +398,7 @@ usage (void) {
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
 			"  put FILE           Put FILE into file system from scratch disk.\n"
 			"  get FILE           Get FILE from file system into scratch disk.\n"
+			"  savetrace FILE     Save scheduler trace (-sched-trace) to FILE.\n"
 #endif
 			"\nOptions:\n"
 			"  -h                 Print this help message and power off.\n"
@@ -326,8 +406,17 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -fair              Use fair-share (virtual runtime) scheduler.\n"
+			"  -tickless          Stop the timer tick while idle.\n"
+			"  -lpj=N             Use N loops per tick, skip calibration.\n"
+			"  -sched-trace       Record scheduler events in a ring buffer,\n"
+			"                     dumped on the console at power off.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -zswap             Compress swapped-out pages in memory first.\n"
+			"  -fault-around=N    Map up to N pages around a file page fault.\n"
 #endif
 			);
 	power_off ();
@@ -343,6 +432,8 @@ power_off (void) {
 #endif
 
 	print_stats ();
+	if (sched_trace_enabled)
+		sched_trace_dump ();
 
 	printf ("Powering off...\n");
 	outw (0x604, 0x2000);               /* Poweroff command for qemu */
@@ -354,6 +445,11 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	intr_print_stats ();
+	palloc_print_stats ();
+	malloc_print_stats ();
+	kmem_print_stats ();
+	sched_trace_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -362,4 +458,7 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
@@ -103,6 +103,18 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Interrupts-off statistics.  Every period with interrupts off
+   delays external interrupts by its length, so we keep track of
+   the longest one, and of the longest external interrupt
+   handler.  Periods that end with `iretq' into a new thread or
+   into user mode are not measured. */
+static uint64_t intr_off_start;     /* TSC when interrupts went off. */
+static void *intr_off_caller;       /* Who turned them off. */
+static uint64_t intr_off_max;       /* Longest period, in TSC cycles. */
+static void *intr_off_max_caller;   /* Who caused it. */
+static uint64_t handler_max;        /* Longest external handler. */
+static uint8_t handler_max_vec;     /* Its vector. */
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -137,6 +149,14 @@ intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF) {
+		uint64_t len = rdtsc () - intr_off_start;
+		if (len > intr_off_max) {
+			intr_off_max = len;
+			intr_off_max_caller = intr_off_caller;
+		}
+	}
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -156,6 +176,10 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON) {
+		intr_off_start = rdtsc ();
+		intr_off_caller = __builtin_return_address (0);
+	}
 	return old_level;
 }
 
@@ -332,6 +356,7 @@ void
 intr_handler (struct intr_frame *frame) {
 	bool external;
 	intr_handler_func *handler;
+	uint64_t start = rdtsc ();
 
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
@@ -344,6 +369,10 @@ intr_handler (struct intr_frame *frame) {
 
 		in_external_intr = true;
 		yield_on_return = false;
+
+		/* The interrupted code had interrupts on. */
+		intr_off_start = start;
+		intr_off_caller = (void *) frame->rip;
 	}
 
 	/* Invoke the interrupt's handler. */
@@ -369,11 +398,25 @@ intr_handler (struct intr_frame *frame) {
 		in_external_intr = false;
 		pic_end_of_interrupt (frame->vec_no);
 
+		if (rdtsc () - start > handler_max) {
+			handler_max = rdtsc () - start;
+			handler_max_vec = frame->vec_no;
+		}
+
 		if (yield_on_return)
 			thread_yield ();
 	}
 }
 
+/* Prints interrupts-off statistics. */
+void
+intr_print_stats (void) {
+	printf ("Interrupts: longest %"PRIu64" cycles off, turned off at %p\n",
+			intr_off_max, intr_off_max_caller);
+	printf ("Interrupts: longest handler %"PRIu64" cycles (%s)\n",
+			handler_max, intr_names[handler_max_vec]);
+}
+
 /* Dumps interrupt frame F to the console, for debugging. */
 void
 intr_dump_frame (const struct intr_frame *f) {
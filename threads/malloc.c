@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/palloc.h"
+#include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -32,7 +34,18 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   In front of the descriptors, each thread has a "magazine" per
+   descriptor: a small stack of free blocks that only that thread
+   touches, so it needs no lock.  malloc() pops a block from the
+   magazine and free() pushes one.  When the magazine is empty,
+   malloc() refills half of it from the descriptor, and when it
+   is full, free() gives half of it back, each under a single
+   acquisition of the descriptor's lock.  The blocks in a
+   magazine still count as in use for their arena, so an arena
+   is not given back while a magazine holds one of its blocks.
+   A thread's magazines are emptied when it exits. */
 
 /* Descriptor. */
 struct desc {
@@ -40,6 +53,28 @@ struct desc {
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	/* Statistics, updated under LOCK. */
+	unsigned long long alloc_cnt;   /* Blocks allocated. */
+	unsigned long long alloc_hits;  /* ...from a magazine. */
+	unsigned long long free_cnt;    /* Blocks freed. */
+	unsigned long long free_hits;   /* ...into a magazine. */
+};
+
+/* Blocks per magazine, and how many move at a time between a
+   magazine and its descriptor. */
+#define MAG_SIZE 8
+#define MAG_BATCH (MAG_SIZE / 2)
+
+/* Magazine.  A thread's magazines, one per descriptor, are
+   allocated the first time it calls malloc() or free(). */
+struct magazine {
+	size_t cnt;                 /* Number of blocks in ROUNDS. */
+	void *rounds[MAG_SIZE];     /* Free blocks, most recent last. */
+
+	/* Statistics, added to the descriptor's on refill or flush. */
+	unsigned alloc_cnt, alloc_hits;
+	unsigned free_cnt, free_hits;
 };
 
 /* Magic number for detecting arena corruption. */
@@ -63,6 +98,10 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *desc_get_block (struct desc *);
+static void desc_put_block (struct desc *, struct block *);
+static struct magazine *get_magazine (struct desc *);
+static void mag_fold_stats (struct desc *, struct magazine *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -86,6 +125,7 @@ malloc (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
+	struct magazine *m;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -112,35 +152,33 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
-	lock_acquire (&d->lock);
-
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
-
-		/* Allocate a page. */
-		a = palloc_get_page (0);
-		if (a == NULL) {
-			lock_release (&d->lock);
-			return NULL;
-		}
+	m = get_magazine (d);
+	if (m == NULL) {
+		lock_acquire (&d->lock);
+		b = desc_get_block (d);
+		d->alloc_cnt++;
+		lock_release (&d->lock);
+		return b;
+	}
 
-		/* Initialize arena and add its blocks to the free list. */
-		a->magic = ARENA_MAGIC;
-		a->desc = d;
-		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
+	m->alloc_cnt++;
+	if (m->cnt > 0)
+		m->alloc_hits++;
+	else {
+		/* Refill half of the magazine. */
+		lock_acquire (&d->lock);
+		while (m->cnt < MAG_BATCH) {
+			b = desc_get_block (d);
+			if (b == NULL)
+				break;
+			m->rounds[m->cnt++] = b;
 		}
+		mag_fold_stats (d, m);
+		lock_release (&d->lock);
+		if (m->cnt == 0)
+			return NULL;
 	}
-
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
-	return b;
+	return m->rounds[--m->cnt];
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -163,6 +201,18 @@ calloc (size_t a, size_t b) {
 	return p;
 }
 
+/* Returns the number of bytes of memory that malloc(SIZE) takes,
+   counting its share of the arena it comes from. */
+size_t
+malloc_footprint (size_t size) {
+	struct desc *d;
+
+	for (d = descs; d < descs + desc_cnt; d++)
+		if (d->block_size >= size)
+			return PGSIZE / d->blocks_per_arena;
+	return DIV_ROUND_UP (size + sizeof (struct arena), PGSIZE) * PGSIZE;
+}
+
 /* Returns the number of bytes allocated for BLOCK. */
 static size_t
 block_size (void *block) {
@@ -204,6 +254,7 @@ free (void *p) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
 		struct desc *d = a->desc;
+		struct magazine *m;
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
@@ -213,24 +264,32 @@ free (void *p) {
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
+			m = get_magazine (d);
+			if (m == NULL) {
+				lock_acquire (&d->lock);
+				desc_put_block (d, b);
+				d->free_cnt++;
+				lock_release (&d->lock);
+				return;
+			}
 
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
+			m->free_cnt++;
+			if (m->cnt < MAG_SIZE)
+				m->free_hits++;
+			else {
+				/* Give back the older half of the magazine. */
 				size_t i;
 
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+				lock_acquire (&d->lock);
+				for (i = 0; i < MAG_BATCH; i++)
+					desc_put_block (d, m->rounds[i]);
+				mag_fold_stats (d, m);
+				lock_release (&d->lock);
+				memmove (m->rounds, m->rounds + MAG_BATCH,
+						(MAG_SIZE - MAG_BATCH) * sizeof *m->rounds);
+				m->cnt -= MAG_BATCH;
 			}
-
-			lock_release (&d->lock);
+			m->rounds[m->cnt++] = b;
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -239,6 +298,158 @@ free (void *p) {
 	}
 }
 
+/* Empties the running thread's magazines into their descriptors
+   and frees them.  Called by thread_exit(). */
+void
+malloc_thread_exit (void) {
+	struct thread *t = thread_current ();
+	struct magazine *mags = t->mags;
+	struct desc *d;
+	size_t i;
+
+	if (mags == NULL)
+		return;
+	t->mags = NULL;
+
+	for (i = 0; i < desc_cnt; i++) {
+		struct magazine *m = &mags[i];
+
+		d = &descs[i];
+		lock_acquire (&d->lock);
+		while (m->cnt > 0)
+			desc_put_block (d, m->rounds[--m->cnt]);
+		mag_fold_stats (d, m);
+		lock_release (&d->lock);
+	}
+
+	/* Not free(), which would give us new magazines. */
+	d = block_to_arena ((struct block *) mags)->desc;
+	lock_acquire (&d->lock);
+	desc_put_block (d, (struct block *) mags);
+	d->free_cnt++;
+	lock_release (&d->lock);
+}
+
+/* Prints how many blocks of each size were allocated and freed,
+   and how often a magazine served the request. */
+void
+malloc_print_stats (void) {
+	struct magazine *mags = thread_current ()->mags;
+	size_t i;
+
+	for (i = 0; i < desc_cnt; i++) {
+		struct desc *d = &descs[i];
+
+		if (mags != NULL)
+			mag_fold_stats (d, &mags[i]);
+		if (d->alloc_cnt == 0)
+			continue;
+		printf ("Malloc: %zu-byte blocks: %llu allocs (%llu%% from magazine), "
+				"%llu frees (%llu%% to magazine)\n", d->block_size,
+				d->alloc_cnt, d->alloc_hits * 100 / d->alloc_cnt,
+				d->free_cnt, d->free_cnt ? d->free_hits * 100 / d->free_cnt : 0);
+	}
+}
+
+/* Returns a free block from D, which must be locked, creating a
+   new arena if necessary.  Returns a null pointer if memory is
+   not available. */
+static struct block *
+desc_get_block (struct desc *d) {
+	struct block *b;
+	struct arena *a;
+
+	/* If the free list is empty, create a new arena. */
+	if (list_empty (&d->free_list)) {
+		size_t i;
+
+		/* Allocate a page. */
+		a = palloc_get_page (0);
+		if (a == NULL)
+			return NULL;
+
+		/* Initialize arena and add its blocks to the free list. */
+		a->magic = ARENA_MAGIC;
+		a->desc = d;
+		a->free_cnt = d->blocks_per_arena;
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_push_back (&d->free_list, &b->free_elem);
+		}
+	}
+
+	/* Get a block from free list and return it. */
+	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+	a = block_to_arena (b);
+	a->free_cnt--;
+	return b;
+}
+
+/* Returns block B to D, which must be locked. */
+static void
+desc_put_block (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		palloc_free_page (a);
+	}
+}
+
+/* Returns the running thread's magazine for D, allocating its
+   magazines if it has none yet.  Returns a null pointer, so that
+   the caller goes straight to D, in an interrupt handler or if
+   memory for the magazines is not available. */
+static struct magazine *
+get_magazine (struct desc *d) {
+	struct thread *t;
+
+	if (intr_context ())
+		return NULL;
+
+	t = thread_current ();
+	if (t->mags == NULL) {
+		size_t size = desc_cnt * sizeof *t->mags;
+		struct desc *md;
+		struct magazine *mags;
+
+		for (md = descs; md < descs + desc_cnt; md++)
+			if (md->block_size >= size)
+				break;
+		ASSERT (md < descs + desc_cnt);
+
+		lock_acquire (&md->lock);
+		mags = (struct magazine *) desc_get_block (md);
+		md->alloc_cnt++;
+		lock_release (&md->lock);
+		if (mags == NULL)
+			return NULL;
+		memset (mags, 0, size);
+		t->mags = mags;
+	}
+	return &t->mags[d - descs];
+}
+
+/* Adds M's statistics to those of D, which must be locked. */
+static void
+mag_fold_stats (struct desc *d, struct magazine *m) {
+	d->alloc_cnt += m->alloc_cnt;
+	d->alloc_hits += m->alloc_hits;
+	d->free_cnt += m->free_cnt;
+	d->free_hits += m->free_hits;
+	m->alloc_cnt = m->alloc_hits = m->free_cnt = m->free_hits = 0;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
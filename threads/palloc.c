@@ -1,15 +1,15 @@
 #include "threads/palloc.h"
-#include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,15 +24,55 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Free memory is kept as
+   blocks of 2**K pages, for K up to PALLOC_MAX_ORDER, each aligned
+   to its size relative to the pool base and kept in the pool's
+   free list for order K.  An allocation of N pages takes a block
+   of the smallest order that fits, splitting a larger one if
+   needed, and gives back the pages past N.  Freeing a block merges
+   it with its buddy, the other half of the next larger block,
+   for as long as the buddy is free too.  An allocation of more
+   than 2**PALLOC_MAX_ORDER pages is served from a run of adjacent
+   free blocks of that order, found by scanning the pool.
+
+   The pools are protected by disabling interrupts rather than by
+   a lock, because do_schedule() frees pages with interrupts off.
+   No operation touches more than a few blocks per order.
+
+   When the CPU has nothing else to do, the idle thread takes a
+   few free pages out of each pool and zeroes them, so that a
+   later PAL_ZERO request for a single page does not have to. */
+
+/* Buddy state of one page in a pool. */
+struct pool_page {
+	struct list_elem elem;          /* In free_lists[order] if free. */
+	uint8_t order;                  /* Order of the block, if free. */
+	bool free;                      /* First page of a free block? */
+	bool allocated;                 /* Handed out by palloc_get_*()? */
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct pool_page *pages;        /* Buddy state of each page. */
+	size_t page_cnt;                /* Number of pages in pool. */
 	uint8_t *base;                  /* Base of pool. */
+	struct list free_lists[PALLOC_ORDER_CNT];  /* Free blocks by order. */
+	size_t free_cnt[PALLOC_ORDER_CNT];         /* Lengths of free_lists. */
+
+	/* Free pages already filled with zeros by the idle thread.
+	   These are out of the buddy allocator, linked through their
+	   pool_page's elem. */
+	struct list zero_list;          /* Zeroed pages. */
+	size_t zero_cnt;                /* Length of zero_list. */
+	unsigned long long zero_fills;  /* Pages zeroed while idle. */
+	unsigned long long zero_hits;   /* PAL_ZERO served from zero_list. */
 };
 
+/* Zeroed pages that the idle thread keeps ready in each pool. */
+#define ZERO_PAGES_TARGET 64
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
@@ -42,6 +82,13 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static size_t pool_alloc_large (struct pool *, size_t page_cnt);
+static void *pool_take_zeroed (struct pool *);
+static void pool_free_block (struct pool *, size_t page_idx, int order);
+static void pool_free_range (struct pool *, size_t page_idx, size_t page_cnt);
+static void pool_mark_allocated (struct pool *, size_t page_idx,
+		size_t page_cnt, bool allocated);
 
 /* multiboot info */
 struct multiboot_info {
@@ -219,16 +266,16 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free_range (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
-				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool_free_range (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -262,19 +309,33 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages = NULL;
+	bool zeroed = false;
+	enum intr_level old_level;
+	size_t page_idx;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
-
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	old_level = intr_disable ();
+	if ((flags & PAL_ZERO) && page_cnt == 1
+			&& (pages = pool_take_zeroed (pool)) != NULL) {
+		zeroed = true;
+		pool->zero_hits++;
+	} else {
+		page_idx = pool_alloc (pool, page_cnt);
+		if (page_idx != SIZE_MAX)
+			pages = pool->base + PGSIZE * page_idx;
+		else if (page_cnt == 1) {
+			/* Out of free blocks, but pages kept zeroed are free too. */
+			pages = pool_take_zeroed (pool);
+			zeroed = pages != NULL;
+		}
+	}
+	if (pages)
+		pool_mark_allocated (pool, pg_no (pages) - pg_no (pool->base),
+				page_cnt, true);
+	intr_set_level (old_level);
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -301,6 +362,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
 	size_t page_idx;
+	enum intr_level old_level;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -314,12 +376,22 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 		NOT_REACHED ();
 
 	page_idx = pg_no (pages) - pg_no (pool->base);
+	ASSERT (page_idx + page_cnt <= pool->page_cnt);
+
+	/* The buddy state only marks the first page of a free block,
+	   so a page that is not allocated is caught here instead. */
+	for (size_t i = 0; i < page_cnt; i++)
+		if (!pool->pages[page_idx + i].allocated)
+			PANIC ("palloc_free: page %p is not allocated",
+					pages + PGSIZE * i);
 
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	old_level = intr_disable ();
+	pool_mark_allocated (pool, page_idx, page_cnt, false);
+	pool_free_range (pool, page_idx, page_cnt);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -328,23 +400,121 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Zeroes a free page and keeps it for a later PAL_ZERO
+   allocation, if either pool has fewer than ZERO_PAGES_TARGET
+   such pages.  Returns true if it zeroed a page, false if there
+   was nothing to do.  Called by the idle thread, with interrupts
+   on so that it can be preempted. */
+bool
+palloc_prezero (void) {
+	struct pool *pools[] = {&kernel_pool, &user_pool};
+	enum intr_level old_level;
+	size_t i;
+
+	for (i = 0; i < sizeof pools / sizeof *pools; i++) {
+		struct pool *pool = pools[i];
+		size_t page_idx;
+
+		if (pool->zero_cnt >= ZERO_PAGES_TARGET)
+			continue;
+
+		old_level = intr_disable ();
+		page_idx = pool_alloc (pool, 1);
+		intr_set_level (old_level);
+		if (page_idx == SIZE_MAX)
+			continue;
+
+		memset (pool->base + PGSIZE * page_idx, 0, PGSIZE);
+
+		old_level = intr_disable ();
+		list_push_front (&pool->zero_list, &pool->pages[page_idx].elem);
+		pool->zero_cnt++;
+		pool->zero_fills++;
+		intr_set_level (old_level);
+		return true;
+	}
+	return false;
+}
+
+/* Stores in FREE_CNT[K] the number of free blocks of 2**K pages
+   in the user pool if PAL_USER is set in FLAGS, otherwise in the
+   kernel pool. */
+void
+palloc_get_free_counts (enum palloc_flags flags,
+		size_t free_cnt[PALLOC_ORDER_CNT]) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	memcpy (free_cnt, pool->free_cnt, sizeof pool->free_cnt);
+	intr_set_level (old_level);
+}
+
+/* Returns the number of free pages, zeroed or not, in the user
+   pool if PAL_USER is set in FLAGS, otherwise in the kernel
+   pool. */
+size_t
+palloc_free_page_cnt (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	enum intr_level old_level;
+	size_t cnt;
+	int k;
+
+	old_level = intr_disable ();
+	cnt = pool->zero_cnt;
+	for (k = 0; k <= PALLOC_MAX_ORDER; k++)
+		cnt += pool->free_cnt[k] << k;
+	intr_set_level (old_level);
+	return cnt;
+}
+
+/* Prints the free blocks of each order in both pools. */
+void
+palloc_print_stats (void) {
+	static const char *names[] = {"kernel", "user"};
+	struct pool *pools[] = {&kernel_pool, &user_pool};
+	int i, k;
+
+	for (i = 0; i < 2; i++) {
+		size_t free_pages = 0;
+
+		printf ("Palloc: %s pool free blocks by order:", names[i]);
+		for (k = 0; k <= PALLOC_MAX_ORDER; k++) {
+			printf (" %zu", pools[i]->free_cnt[k]);
+			free_pages += pools[i]->free_cnt[k] << k;
+		}
+		printf (" (%zu of %zu pages free)\n", free_pages, pools[i]->page_cnt);
+		printf ("Palloc: %s pool zeroed %llu pages while idle, "
+				"served %llu zeroed pages, %zu left\n", names[i],
+				pools[i]->zero_fills, pools[i]->zero_hits, pools[i]->zero_cnt);
+	}
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's buddy state at its base.
+     Calculate the space needed for it
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t meta_bytes = ROUND_UP (pgcnt * sizeof (struct pool_page), PGSIZE);
+	int k;
 
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	p->pages = *bm_base;
+	p->page_cnt = pgcnt;
 	p->base = (void *) start;
+	for (k = 0; k < PALLOC_ORDER_CNT; k++) {
+		list_init (&p->free_lists[k]);
+		p->free_cnt[k] = 0;
+	}
+	list_init (&p->zero_list);
+	p->zero_cnt = 0;
+	p->zero_fills = p->zero_hits = 0;
 
-	// Mark all to unusable.
-	bitmap_set_all(p->used_map, true);
+	// Mark all to unusable and not allocated.
+	memset (p->pages, 0, meta_bytes);
 
-	*bm_base += bm_pages;
+	*bm_base += meta_bytes;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -353,6 +523,159 @@ static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Allocates PAGE_CNT contiguous pages from POOL's free blocks and
+   returns the index of the first, or SIZE_MAX if no free block
+   is big enough, or for more than 2**PALLOC_MAX_ORDER pages, no
+   run of free blocks. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt) {
+	struct pool_page *pp;
+	size_t page_idx;
+	int order, k;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (page_cnt > (size_t) 1 << PALLOC_MAX_ORDER)
+		return pool_alloc_large (pool, page_cnt);
+
+	/* Smallest order that holds PAGE_CNT pages. */
+	for (order = 0; order <= PALLOC_MAX_ORDER; order++)
+		if ((size_t) 1 << order >= page_cnt)
+			break;
+
+	for (k = order; k <= PALLOC_MAX_ORDER; k++)
+		if (!list_empty (&pool->free_lists[k]))
+			break;
+	if (k > PALLOC_MAX_ORDER || page_cnt == 0)
+		return SIZE_MAX;
+
+	pp = list_entry (list_pop_front (&pool->free_lists[k]),
+			struct pool_page, elem);
+	page_idx = pp - pool->pages;
+	pool->free_cnt[k]--;
+	pp->free = false;
+
+	/* Split off upper halves until the block is of ORDER. */
+	while (k > order) {
+		k--;
+		pool_free_block (pool, page_idx + ((size_t) 1 << k), k);
+	}
+
+	/* Give back the pages beyond PAGE_CNT. */
+	pool_free_range (pool, page_idx + page_cnt,
+			((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* Allocates PAGE_CNT contiguous pages, more than the largest
+   block, from a run of adjacent free blocks of PALLOC_MAX_ORDER in
+   POOL.  Returns the index of the first page, or SIZE_MAX if there
+   is no such run.  Takes time linear in the size of the pool. */
+static size_t
+pool_alloc_large (struct pool *pool, size_t page_cnt) {
+	const size_t block = (size_t) 1 << PALLOC_MAX_ORDER;
+	size_t block_cnt = DIV_ROUND_UP (page_cnt, block);
+	size_t run_idx = 0, run_cnt = 0;
+	size_t page_idx, i;
+
+	for (page_idx = 0; page_idx + block <= pool->page_cnt;
+			page_idx += block) {
+		struct pool_page *pp = &pool->pages[page_idx];
+
+		if (!pp->free || pp->order != PALLOC_MAX_ORDER) {
+			run_cnt = 0;
+			continue;
+		}
+		if (run_cnt++ == 0)
+			run_idx = page_idx;
+		if (run_cnt == block_cnt)
+			break;
+	}
+	if (run_cnt < block_cnt)
+		return SIZE_MAX;
+
+	for (i = 0; i < block_cnt; i++) {
+		struct pool_page *pp = &pool->pages[run_idx + i * block];
+
+		list_remove (&pp->elem);
+		pool->free_cnt[PALLOC_MAX_ORDER]--;
+		pp->free = false;
+	}
+
+	/* Give back the pages beyond PAGE_CNT. */
+	pool_free_range (pool, run_idx + page_cnt, block_cnt * block - page_cnt);
+	return run_idx;
+}
+
+/* Removes a page from POOL's zeroed pages and returns it, or
+   returns a null pointer if there are none. */
+static void *
+pool_take_zeroed (struct pool *pool) {
+	struct pool_page *pp;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (list_empty (&pool->zero_list))
+		return NULL;
+	pp = list_entry (list_pop_front (&pool->zero_list), struct pool_page, elem);
+	pool->zero_cnt--;
+	return pool->base + PGSIZE * (pp - pool->pages);
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL, merging
+   it with its buddy for as long as the buddy is free. */
+static void
+pool_free_block (struct pool *pool, size_t page_idx, int order) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (page_idx % ((size_t) 1 << order) == 0);
+
+	while (order < PALLOC_MAX_ORDER) {
+		size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+		struct pool_page *buddy = &pool->pages[buddy_idx];
+
+		if (buddy_idx >= pool->page_cnt || !buddy->free || buddy->order != order)
+			break;
+		list_remove (&buddy->elem);
+		pool->free_cnt[order]--;
+		buddy->free = false;
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+
+	pool->pages[page_idx].free = true;
+	pool->pages[page_idx].order = order;
+	list_push_front (&pool->free_lists[order], &pool->pages[page_idx].elem);
+	pool->free_cnt[order]++;
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, as the largest
+   aligned blocks that make up the range. */
+static void
+pool_free_range (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < PALLOC_MAX_ORDER
+				&& page_idx % ((size_t) 2 << order) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		pool_free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Sets whether the PAGE_CNT pages at PAGE_IDX in POOL are
+   allocated to ALLOCATED. */
+static void
+pool_mark_allocated (struct pool *pool, size_t page_idx, size_t page_cnt,
+		bool allocated) {
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++)
+		pool->pages[page_idx + i].allocated = allocated;
+}
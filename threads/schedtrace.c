@@ -0,0 +1,182 @@
+#include "threads/schedtrace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+#include "intrinsic.h"
+
+/* Number of events the ring buffer holds.  Must be a power of
+   2. */
+#define SCHED_TRACE_SIZE 4096
+
+/* Header at the start of a dump.  Events follow, oldest first. */
+struct sched_trace_header {
+	char magic[8];              /* "SCHEDTRC". */
+	uint32_t version;           /* SCHED_TRACE_VERSION. */
+	uint32_t event_cnt;         /* Number of events in the dump. */
+	uint64_t dropped;           /* Events overwritten before the dump. */
+	uint64_t ref_tsc;           /* TSC at timer tick REF_TICKS... */
+	int64_t ref_ticks;
+	uint64_t end_tsc;           /* ...and at tick END_TICKS, so that */
+	int64_t end_ticks;          /* cycles can be turned into time. */
+};
+#define SCHED_TRACE_VERSION 1
+
+bool sched_trace_enabled;
+
+static struct sched_event events[SCHED_TRACE_SIZE];
+static uint64_t event_total;    /* Number of events ever recorded. */
+
+/* First point after the timer started ticking, see
+   sched_trace_record(). */
+static uint64_t ref_tsc;
+static int64_t ref_ticks;
+
+/* Records an event of TYPE about thread T with argument ARG.
+   May be called from any context, including interrupt
+   handlers. */
+void
+sched_trace_record (enum sched_event_type type, const struct thread *t,
+		int32_t arg) {
+	enum intr_level old_level;
+	struct sched_event *e;
+
+	old_level = intr_disable ();
+	e = &events[event_total++ & (SCHED_TRACE_SIZE - 1)];
+	e->tsc = rdtsc ();
+	e->tid = t->tid;
+	e->arg = arg;
+	e->type = type;
+	e->priority = t->priority;
+	memset (e->reserved, 0, sizeof e->reserved);
+
+	if (ref_ticks == 0 && (ref_ticks = timer_ticks ()) != 0)
+		ref_tsc = e->tsc;
+	intr_set_level (old_level);
+}
+
+/* Number of events in the buffer. */
+static size_t
+event_cnt (void) {
+	return event_total < SCHED_TRACE_SIZE ? event_total : SCHED_TRACE_SIZE;
+}
+
+/* Fills in H for a dump of the events in the buffer, and sets
+   *FIRST to the index of the oldest and *TAIL to the number of
+   them before the end of the buffer.  Recording must be paused. */
+static void
+dump_header (struct sched_trace_header *h, size_t *first, size_t *tail) {
+	size_t cnt = event_cnt ();
+
+	*first = (event_total - cnt) & (SCHED_TRACE_SIZE - 1);
+	*tail = *first + cnt > SCHED_TRACE_SIZE ? SCHED_TRACE_SIZE - *first : cnt;
+
+	memset (h, 0, sizeof *h);
+	memcpy (h->magic, "SCHEDTRC", sizeof h->magic);
+	h->version = SCHED_TRACE_VERSION;
+	h->event_cnt = cnt;
+	h->dropped = event_total - cnt;
+	h->ref_tsc = ref_tsc;
+	h->ref_ticks = ref_ticks;
+	h->end_ticks = timer_ticks ();
+	h->end_tsc = rdtsc ();
+}
+
+/* Prints the SIZE bytes at BUF in hex, 32 bytes to a line,
+   continuing the partial line of *COL bytes in LINE. */
+static void
+dump_hex (const void *buf_, size_t size, char line[65], size_t *col) {
+	static const char digits[] = "0123456789abcdef";
+	const uint8_t *buf = buf_;
+
+	for (; size > 0; size--, buf++) {
+		line[*col * 2] = digits[*buf >> 4];
+		line[*col * 2 + 1] = digits[*buf & 15];
+		if (++*col == 32) {
+			line[64] = '\0';
+			printf ("%s\n", line);
+			*col = 0;
+		}
+	}
+}
+
+/* Prints the trace on the console in hex, between "SCHEDTRC begin"
+   and "SCHEDTRC end" lines, in the same format that the "savetrace"
+   action writes to a file.  Called at power off with -sched-trace,
+   so that a kernel without a file system can export its trace too;
+   utils/sched-trace reads it back out of the console log. */
+void
+sched_trace_dump (void) {
+	struct sched_trace_header h;
+	size_t first, tail, col = 0;
+	char line[65];
+
+	sched_trace_enabled = false;
+	barrier ();
+
+	dump_header (&h, &first, &tail);
+	printf ("SCHEDTRC begin\n");
+	dump_hex (&h, sizeof h, line, &col);
+	dump_hex (events + first, tail * sizeof *events, line, &col);
+	dump_hex (events, (h.event_cnt - tail) * sizeof *events, line, &col);
+	if (col > 0) {
+		line[col * 2] = '\0';
+		printf ("%s\n", line);
+	}
+	printf ("SCHEDTRC end\n");
+}
+
+#ifdef FILESYS
+/* Writes the trace to file ARGV[1] in the file system, for the
+   "savetrace" action.  Recording is paused while the buffer is
+   copied out. */
+void
+sched_trace_save (char **argv) {
+	const char *file_name = argv[1];
+	struct sched_trace_header h;
+	size_t cnt, first, tail;
+	struct file *dst;
+	bool was_enabled;
+	off_t size;
+
+	was_enabled = sched_trace_enabled;
+	sched_trace_enabled = false;
+	barrier ();
+
+	dump_header (&h, &first, &tail);
+	cnt = h.event_cnt;
+
+	printf ("Saving %zu scheduler events to '%s'...\n", cnt, file_name);
+	size = sizeof h + cnt * sizeof *events;
+	if (!filesys_create (file_name, size))
+		PANIC ("%s: create failed", file_name);
+	dst = filesys_open (file_name);
+	if (dst == NULL)
+		PANIC ("%s: open failed", file_name);
+	if (file_write (dst, &h, sizeof h) != sizeof h
+			|| file_write (dst, events + first, tail * sizeof *events)
+				!= (off_t) (tail * sizeof *events)
+			|| file_write (dst, events, (cnt - tail) * sizeof *events)
+				!= (off_t) ((cnt - tail) * sizeof *events))
+		PANIC ("%s: write failed", file_name);
+	file_close (dst);
+
+	sched_trace_enabled = was_enabled;
+}
+#endif
+
+/* Prints scheduler trace statistics, if tracing is on. */
+void
+sched_trace_print_stats (void) {
+	if (sched_trace_enabled)
+		printf ("Sched trace: %"PRIu64" events, %"PRIu64" overwritten\n",
+				event_total, event_total - event_cnt ());
+}
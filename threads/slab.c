@@ -0,0 +1,272 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator.
+
+   Each cache owns a set of slabs.  A slab is one page: a header
+   followed by as many objects as fit, packed at the object size
+   rounded up to 8 bytes.  Free objects in a slab are kept on a
+   singly linked list.  The link is stored in the object itself,
+   unless the cache has a constructor, in which case it goes in an
+   extra word after the object so that freed objects keep their
+   constructed state.
+
+   A cache keeps its slabs on three lists: partial slabs, which
+   have both free and allocated objects, full slabs and empty
+   slabs.  Allocation takes from a partial slab if there is one,
+   otherwise from an empty slab, otherwise from a new slab.  At
+   most KMEM_EMPTY_MAX empty slabs are kept; past that, a slab
+   whose last object is freed goes back to the page allocator.
+
+   Because the header is at the start of the page, the slab that
+   an object belongs to is found by rounding its address down. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Empty slabs kept per cache. */
+#define KMEM_EMPTY_MAX 1
+
+/* Maximum number of caches. */
+#define KMEM_CACHE_MAX 16
+
+/* Cache. */
+struct kmem_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t obj_size;            /* Object size requested. */
+	size_t stride;              /* Distance between objects. */
+	size_t link_ofs;            /* Offset of free list link in object. */
+	size_t objs_per_slab;       /* Number of objects in a slab. */
+	kmem_ctor_func *ctor;       /* Constructor, or null. */
+	struct list partial;        /* Slabs with free and used objects. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list empty;          /* Slabs with no used objects. */
+	size_t empty_cnt;           /* Length of EMPTY. */
+	struct lock lock;           /* Lock. */
+
+	/* Statistics. */
+	size_t slab_cnt;            /* Slabs now owned. */
+	size_t in_use;              /* Objects now allocated. */
+	size_t peak_in_use;         /* Largest value of IN_USE. */
+	unsigned long long alloc_cnt;  /* Calls to kmem_cache_alloc(). */
+};
+
+/* Slab header. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* In one of the cache's lists. */
+	void *free;                 /* First free object, or null. */
+	size_t in_use;              /* Allocated objects. */
+};
+
+/* Offset of the first object in a slab. */
+#define SLAB_OBJ_OFS ROUND_UP (sizeof (struct slab), 16)
+
+/* Our set of caches. */
+static struct kmem_cache caches[KMEM_CACHE_MAX];
+static size_t cache_cnt;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (void *obj);
+
+/* Creates and returns a cache for objects of SIZE bytes, called
+   NAME in statistics.  If CTOR is non-null, it is called on each
+   object when its slab is created.  The cache is never
+   destroyed. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+
+	ASSERT (name != NULL);
+	ASSERT (size > 0);
+
+	if (cache_cnt >= KMEM_CACHE_MAX)
+		PANIC ("kmem_cache_create: too many caches");
+	c = &caches[cache_cnt++];
+
+	c->name = name;
+	c->obj_size = size;
+	c->ctor = ctor;
+	if (ctor != NULL) {
+		c->link_ofs = ROUND_UP (size, sizeof (void *));
+		c->stride = c->link_ofs + sizeof (void *);
+	} else {
+		c->link_ofs = 0;
+		c->stride = ROUND_UP (size, sizeof (void *));
+	}
+	c->objs_per_slab = (PGSIZE - SLAB_OBJ_OFS) / c->stride;
+	ASSERT (c->objs_per_slab > 0);
+
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	lock_init (&c->lock);
+
+	c->slab_cnt = c->in_use = c->peak_in_use = 0;
+	c->alloc_cnt = 0;
+	return c;
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available.  Unless C has a
+   constructor, the object's contents are unspecified. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (!list_empty (&c->empty)) {
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		c->empty_cnt--;
+		list_push_front (&c->partial, &s->elem);
+	} else {
+		s = slab_create (c);
+		if (s == NULL) {
+			lock_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	/* Take the first free object. */
+	obj = s->free;
+	ASSERT (obj != NULL);
+	s->free = *(void **) ((uint8_t *) obj + c->link_ofs);
+	if (++s->in_use == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+
+	c->alloc_cnt++;
+	if (++c->in_use > c->peak_in_use)
+		c->peak_in_use = c->in_use;
+	lock_release (&c->lock);
+	return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C, to
+   C.  Does nothing if OBJ is null. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (obj);
+	ASSERT (s->cache == c);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	*(void **) ((uint8_t *) obj + c->link_ofs) = s->free;
+	s->free = obj;
+	c->in_use--;
+
+	if (s->in_use-- == c->objs_per_slab) {
+		/* Was full. */
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->in_use == 0) {
+		list_remove (&s->elem);
+		if (c->empty_cnt < KMEM_EMPTY_MAX) {
+			list_push_front (&c->empty, &s->elem);
+			c->empty_cnt++;
+		} else {
+			s->magic = 0;
+			c->slab_cnt--;
+			palloc_free_page (s);
+		}
+	}
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for each cache, including how much memory
+   an object takes compared to allocating it with malloc(). */
+void
+kmem_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < cache_cnt; i++) {
+		struct kmem_cache *c = &caches[i];
+		size_t slab_bytes = PGSIZE / c->objs_per_slab;
+		size_t malloc_bytes = malloc_footprint (c->obj_size);
+
+		printf ("Slab: %s: %zu in use (peak %zu), %zu slabs, %llu allocs, "
+				"%zu B objects take %zu B (%zu B with malloc)\n",
+				c->name, c->in_use, c->peak_in_use, c->slab_cnt,
+				c->alloc_cnt, c->obj_size, slab_bytes, malloc_bytes);
+	}
+}
+
+/* Allocates a new slab for cache C, which must be locked, and
+   constructs its objects.  Returns a null pointer if memory is
+   not available. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	uint8_t *obj;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->in_use = 0;
+	s->free = NULL;
+
+	/* Build the free list backward, so that objects are handed out
+	   in address order. */
+	obj = (uint8_t *) s + SLAB_OBJ_OFS + c->objs_per_slab * c->stride;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		obj -= c->stride;
+		if (c->ctor != NULL)
+			c->ctor (obj);
+		*(void **) (obj + c->link_ofs) = s->free;
+		s->free = obj;
+	}
+
+	c->slab_cnt++;
+	return s;
+}
+
+/* Returns the slab that OBJ is inside. */
+static struct slab *
+obj_to_slab (void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid. */
+	ASSERT (s != NULL);
+	ASSERT (s->magic == SLAB_MAGIC);
+
+	/* Check that the object is properly aligned for the slab. */
+	ASSERT (pg_ofs (obj) >= SLAB_OBJ_OFS);
+	ASSERT ((pg_ofs (obj) - SLAB_OBJ_OFS) % s->cache->stride == 0);
+
+	return s;
+}
@@ -32,6 +32,48 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Initializes spinlock LOCK.  A spinlock protects a few words of
+   shared data for a handful of instructions.  It must be held
+   with interrupts off and must not be held across a context
+   switch, except for the hand-over in thread_block_spin().  On a
+   uniprocessor it never actually spins; it is there so that code
+   which is written with it stays correct when more than one CPU
+   runs kernel code. */
+void
+spinlock_init (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	lock->locked = 0;
+}
+
+/* Acquires LOCK, spinning until it is free.  Interrupts must be
+   off. */
+void
+spinlock_acquire (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n (&lock->locked, __ATOMIC_RELAXED))
+			asm volatile ("pause");
+}
+
+/* Releases LOCK, which must be held. */
+void
+spinlock_release (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (lock->locked);
+
+	__atomic_store_n (&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+/* Arrival counter for semaphore waiters, so that waiters of
+   equal priority are woken in FIFO order. */
+static uint64_t sema_seq;
+
+static bool sema_waiter_less (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -46,7 +88,8 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, sema_waiter_less, NULL);
+	spinlock_init (&sema->lock);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -65,13 +108,19 @@ sema_down (struct semaphore *sema) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
+	spinlock_acquire (&sema->lock);
 	while (sema->value == 0) { // 공유자원 접근 할수 없으면
-		//list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered(&sema -> waiters, &thread_current()-> elem, thr_cmp_priority, NULL);
-		// semaphore의 waiters 에 priority 순서에 따라 insert
-		thread_block ();
+		struct thread *curr = thread_current ();
+		curr->wait_on_sema = sema;
+		curr->sema_seq = sema_seq++;
+		heap_insert (&sema->waiters, &curr->sema_elem); // priority heap에 insert
+		// BLOCKED가 되고 CPU에서 내려간 뒤에 다음 thread가 lock을 풂
+		// (그 전에 sema_up이 이 thread를 찾아서 unblock 하지 못함)
+		thread_block_spin (&sema->lock);
+		spinlock_acquire (&sema->lock);
 	}
 	sema->value--;
+	spinlock_release (&sema->lock);
 	intr_set_level (old_level);
 }
 
@@ -88,6 +137,7 @@ sema_try_down (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
+	spinlock_acquire (&sema->lock);
 	if (sema->value > 0)
 	{
 		sema->value--;
@@ -95,6 +145,7 @@ sema_try_down (struct semaphore *sema) {
 	}
 	else
 		success = false;
+	spinlock_release (&sema->lock);
 	intr_set_level (old_level);
 
 	return success;
@@ -107,27 +158,71 @@ sema_try_down (struct semaphore *sema) {
 void
 sema_up (struct semaphore *sema) {
 	enum intr_level old_level;
+	struct thread *t = NULL;
 
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable();
+	spinlock_acquire (&sema->lock);
 
-	if (!list_empty (&sema->waiters)) {
-		struct thread * t;
-		list_sort(&sema->waiters, thr_cmp_priority, NULL); // waiters에서 빼기 전에 priority로 sort
-		t = list_entry(list_pop_front(&sema->waiters), struct thread, elem); 
-		thread_unblock(t); // front에 있는 것이 priority 제일 높음 -> ready list
-		sema->value++;
+	if (!heap_empty (&sema->waiters)) {
+		// heap top이 priority 제일 높은 waiter (같으면 먼저 온 것)
+		t = heap_entry (heap_pop (&sema->waiters), struct thread, sema_elem);
+		t->wait_on_sema = NULL;
+	}
+	sema->value++;
+	spinlock_release (&sema->lock);
+
+	if (t != NULL) {
+		thread_unblock(t); // -> ready queue
 		if (!intr_context()) {
 			test_highest_priority(); // curr thread와 ready list priority 비교하고 스케줄링
 		}
-	}else {
-		sema->value++;
 	}
 
 	intr_set_level (old_level);
 }
 
+/* Orders semaphore waiters by priority, then by arrival. */
+static bool
+sema_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, sema_elem);
+	const struct thread *b = heap_entry (b_, struct thread, sema_elem);
+
+	if (a->priority != b->priority)
+		return a->priority < b->priority;
+	return a->sema_seq > b->sema_seq;
+}
+
+/* Returns the highest priority among SEMA's waiters, or
+   PRI_MIN - 1 if there are none. */
+int
+sema_highest_priority (struct semaphore *sema) {
+	struct heap_elem *top = heap_top (&sema->waiters);
+
+	if (top == NULL)
+		return PRI_MIN - 1;
+	return heap_entry (top, struct thread, sema_elem)->priority;
+}
+
+/* Moves T, which waits on SEMA, to the heap position for its
+   current priority.  Called after T's priority changed while it
+   was blocked. */
+void
+sema_reposition_waiter (struct semaphore *sema, struct thread *t) {
+	enum intr_level old_level;
+
+	ASSERT (t->wait_on_sema == sema);
+
+	old_level = intr_disable ();
+	spinlock_acquire (&sema->lock);
+	heap_remove (&sema->waiters, &t->sema_elem);
+	heap_insert (&sema->waiters, &t->sema_elem);
+	spinlock_release (&sema->lock);
+	intr_set_level (old_level);
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -208,17 +303,19 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	struct thread *curr = thread_current();
+	enum intr_level old_level = intr_disable ();
 	if (lock -> holder) {
 		curr -> wait_on_lock = lock;
-		list_insert_ordered(&lock->holder->donation_list, &curr->donation_elem, thr_donation_cmp_priority, NULL);
-		// lock 가진 thread의 donation_list 에 curr의 priority 이용해 insert
-		donate_priority();
+		donate_priority(); // wait_on_lock chain 따라 holder들에게 donate
 	}
 
-	sema_down (&lock->semaphore);
+	sema_down (&lock->semaphore); // lock의 waiter heap에 들어가서 대기
 
 	curr->wait_on_lock = NULL; // curr의 wait_on_lock 없애기
 	lock->holder = curr; // lock의 holder를 curr로
+	list_push_back (&curr->held_locks, &lock->elem);
+	update_priority (); // 아직 이 lock 기다리는 thread들의 donation 받기
+	intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -235,8 +332,11 @@ lock_try_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current ();
+		if (!thread_mlfqs)
+			list_push_back (&thread_current ()->held_locks, &lock->elem);
+	}
 	return success;
 }
 
@@ -259,10 +359,12 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	remove_with_lock_in_donation_list(lock); // 현재 thread의 donation_list에서 이 lock 대기 thread remove
+	enum intr_level old_level = intr_disable ();
+	list_remove (&lock->elem); // held_locks에서 제거하면 이 lock waiter들의 donation도 끝
 	update_priority(); // priority update
-
 	lock->holder = NULL;
+	intr_set_level (old_level);
+
 	sema_up (&lock->semaphore);
 }
 
@@ -289,14 +391,8 @@ sema_cmp_priority (const struct list_elem *x, const struct list_elem *y, void *a
 	struct semaphore_elem *sema_elem_x = list_entry(x, struct semaphore_elem, elem);
 	struct semaphore_elem *sema_elem_y = list_entry(y, struct semaphore_elem, elem);
 
-	struct list *waiter_sema_x = &(sema_elem_x -> semaphore.waiters);
-	struct list *waiter_sema_y = &(sema_elem_y -> semaphore.waiters);
-
-	// semaphored의 waiters는 이미 정렬되어있으므로 제일 앞에것들 비교
-	int priority_sema_x = list_entry(list_begin(waiter_sema_x), struct thread, elem) -> priority;
-	int priority_sema_y = list_entry(list_begin(waiter_sema_y), struct thread, elem) -> priority;
-
-	return priority_sema_x > priority_sema_y;
+	// semaphore의 waiters는 heap이므로 top만 비교
+	return sema_highest_priority(&sema_elem_x->semaphore) > sema_highest_priority(&sema_elem_y->semaphore);
 }
 
 /* Initializes condition variable COND.  A condition variable
@@ -339,9 +435,8 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	//list_push_back (&cond->waiters, &waiter.elem);
-	// cond의 waiters에 priority에 맞게 semaphore를 insert
-	list_insert_ordered(&cond -> waiters, &waiter.elem, sema_cmp_priority, NULL);
+	list_push_back (&cond->waiters, &waiter.elem);
+	// 아직 sema_down 전이라 waiter가 비어있으므로 정렬은 signal 할 때
 
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
@@ -363,9 +458,10 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	if (!list_empty (&cond->waiters)){
-		list_sort (&cond->waiters, sema_cmp_priority, NULL); // 깨울때도 wait 도중에 priority 바뀌었을 수 있으므로 sort 
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+		// wait 도중에 priority 바뀌었을 수 있으므로 깨울 때 제일 높은 것 찾기
+		struct list_elem *e = list_min (&cond->waiters, sema_cmp_priority, NULL);
+		list_remove (e);
+		sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
 	}
 }
 
@@ -7,11 +7,15 @@
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/schedtrace.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "intrinsic.h"
 #include "threads/fixed_point.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -28,9 +32,14 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Lists of processes in THREAD_READY state, that is, processes
+   that are ready to run but not actually running.  There is one
+   FIFO queue per priority, and bit N of ready_bitmap is set
+   whenever ready_queues[N] is non-empty, so the highest ready
+   priority can be found with a single bit scan. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static size_t ready_cnt;        /* # of threads in ready_queues. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -44,6 +53,16 @@ static struct lock tid_lock;
 /* Thread destruction requests */
 static struct list destruction_req;
 
+/* Pages of dead threads, kept for reuse by thread_create()
+   instead of going back to the page allocator.  init_thread()
+   clears the struct thread at the bottom of the page and nothing
+   reads the kernel stack above it before writing it, so a cached
+   page is handed out without zeroing the rest.  Only touched
+   with interrupts off. */
+#define THREAD_PAGE_CACHE_MAX 32
+static void *thread_page_cache[THREAD_PAGE_CACHE_MAX];
+static size_t thread_page_cache_cnt;
+
 /* Statistics. */
 static long long idle_ticks;    /* # of timer ticks spent idle. */
 static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
@@ -53,11 +72,20 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* Spinlock that a thread blocking in thread_block_spin() still
+   holds, for the thread switched to to release.  One per CPU, once
+   there is more than one. */
+static struct spinlock *switch_lock;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the fair-share scheduler.
+   Controlled by kernel command-line option "-fair". */
+bool thread_fair;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -65,11 +93,32 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
+static void switch_finish (void);
 static tid_t allocate_tid (void);
-
-static struct list sleep_list; //sleep thread list
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
+
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static int ready_queue_highest (void);
+static void set_thread_priority (struct thread *, int priority);
+
+/* Hashed timing wheel of sleeping threads.  A thread that wakes
+   up at tick T is kept in sleep_wheel[T % SLEEP_WHEEL_SIZE], so
+   inserting a sleeper and expiring a bucket do not depend on the
+   total number of sleepers.  Bit N of sleep_wheel_bitmap is set
+   whenever sleep_wheel[N] is non-empty. */
+#define SLEEP_WHEEL_BITS 8
+#define SLEEP_WHEEL_SIZE (1 << SLEEP_WHEEL_BITS)
+#define SLEEP_WHEEL_MASK (SLEEP_WHEEL_SIZE - 1)
+static struct list sleep_wheel[SLEEP_WHEEL_SIZE];
+static uint64_t sleep_wheel_bitmap[SLEEP_WHEEL_SIZE / 64];
+static int64_t sleep_wheel_tick; // awake_thread가 마지막으로 처리한 tick
 static int64_t next_wakeup_tick; // wakeup 실행할 다음 틱
 
+static int64_t sleep_wheel_next (int64_t from);
+
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
 
@@ -93,6 +142,78 @@ static uint64_t gdt[3] = { 0, 0x00af9a000000ffff, 0x00cf92000000ffff };
 
 int load_avg;
 
+/* 59/60 in fixed point, for load_avg. */
+#define LOAD_AVG_DECAY ((59 * F) / 60)
+
+/* recent_cpu decay table.  Each second starts a new MLFQS epoch,
+   and decay_table[EPOCH % DECAY_HISTORY] keeps 2 * load_avg of
+   that epoch, so the epoch's decay factor is
+   2 * load_avg / (2 * load_avg + 1).  A thread that was not ready
+   or running applies the factors of the epochs it missed when it
+   is enqueued again, instead of every thread being decayed every
+   second. */
+#define DECAY_HISTORY 256
+static int decay_table[DECAY_HISTORY];
+static int64_t mlfqs_epoch;
+
+static void mlfqs_refresh (struct thread *);
+
+/* Once a second the ready threads are moved to the queues for
+   their new priorities.  That takes time proportional to the
+   number of ready threads, so the timer interrupt leaves it to
+   the worker thread, which handles MLFQS_RESORT_BATCH threads at
+   a time with interrupts off.
+
+   Every thread pushed onto a ready queue is up to date for the
+   current epoch, and the worker moves each thread it updates to
+   the back of its queue too.  So the threads still to update are
+   always at the front of their queues, and the worker only needs
+   to remember which queue it is on between batches. */
+#define MLFQS_RESORT_BATCH 8
+static void mlfqs_resort (void *aux);
+static struct work mlfqs_resort_work;
+
+/* Fair-share scheduler.  Ready threads are kept in fair_queue,
+   ordered by vruntime: the TSC cycles a thread has run, scaled
+   by NICE_0_WEIGHT / its weight, so that a thread with twice the
+   weight accumulates vruntime half as fast.  The thread with the
+   least vruntime runs next.  Each runs for a slice proportional
+   to its share of the total ready weight, so that every ready
+   thread runs once per FAIR_LATENCY_TICKS when possible. */
+#define NICE_MIN -20
+#define NICE_MAX 20
+#define NICE_0_WEIGHT 1024
+#define FAIR_LATENCY_TICKS 6    /* Target period to run every thread. */
+#define FAIR_MIN_SLICE 1        /* Minimum slice, in ticks. */
+
+/* Weight of each nice value from NICE_MIN to NICE_MAX.  Each step
+   is about 1.25x, so one nice level is worth about 10% CPU. */
+static const int fair_weights[NICE_MAX - NICE_MIN + 1] = {
+	88761, 71755, 56483, 46273, 36291,
+	29154, 23254, 18705, 14949, 11916,
+	 9548,  7620,  6100,  4904,  3906,
+	 3121,  2501,  1991,  1586,  1277,
+	 1024,   820,   655,   526,   423,
+	  335,   272,   215,   172,   137,
+	  110,    87,    70,    56,    45,
+	   36,    29,    23,    18,    15,
+	   12,
+};
+
+static struct heap fair_queue;
+static int64_t fair_load;           /* Sum of ready threads' weights. */
+static int64_t fair_min_vruntime;   /* Never decreases. */
+static uint64_t fair_tick_cycles;   /* Estimated TSC cycles per tick. */
+static uint64_t fair_last_tick;     /* TSC at the previous tick. */
+
+static bool fair_less (const struct heap_elem *, const struct heap_elem *,
+		void *aux);
+static int fair_weight (const struct thread *);
+static void fair_update_curr (void);
+static void fair_place (struct thread *);
+static bool fair_should_preempt (int64_t granularity);
+static bool fair_tick (void);
+
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
@@ -121,10 +242,15 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	for (int i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&ready_queues[i]);
+	ready_bitmap = 0;
+	ready_cnt = 0;
+	heap_init (&fair_queue, fair_less, NULL);
 	list_init (&destruction_req);
 
-	list_init (&sleep_list); //init sleep_list 
+	for (int i = 0; i < SLEEP_WHEEL_SIZE; i++) //init sleep wheel
+		list_init (&sleep_wheel[i]);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
@@ -153,6 +279,10 @@ thread_start (void) {
 
 	/* Wait for the idle thread to initialize idle_thread. */
 	sema_down (&idle_started);
+
+	/* Start the worker for deferred work. */
+	work_init (&mlfqs_resort_work, mlfqs_resort, NULL);
+	workqueue_init ();
 }
 
 /* Called by the timer interrupt handler at each timer tick.
@@ -172,10 +302,21 @@ thread_tick (void) {
 		kernel_ticks++;
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (thread_fair) {
+		if (fair_tick ())
+			intr_yield_on_return ();
+	} else if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 }
 
+/* Counts TICKS timer ticks that the idle thread slept through
+   without a timer interrupt.  Called by the timer in tickless
+   mode. */
+void
+thread_idle_ticks (int64_t ticks) {
+	idle_ticks += ticks;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
@@ -207,13 +348,14 @@ thread_create (const char *name, int priority,
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_get ();
 	if (t == NULL)
 		return TID_ERROR;
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
+	sched_trace (SCHED_EV_CREATE, t, thread_current ()->tid);
 
 // P4-4-2 추가
 #ifdef EFILESYS
@@ -233,12 +375,9 @@ thread_create (const char *name, int priority,
 	t->tf.cs = SEL_KCSEG;
 	t->tf.eflags = FLAG_IF;
 
-// P2-3 system call fd_list 메모리 할당 및 초기화
+// P2-3 system call fd_list 초기화 (struct thread 안에 있으므로 malloc 불필요)
 #ifdef USERPROG
-	t -> fd_list = (struct list *) malloc(sizeof(struct list));
-	if (t->fd_list == NULL) {
-		return TID_ERROR;
-	}
+	t->fd_list = &t->fd_list_head;
 	list_init(t->fd_list);
 
 	// P2-3-fork-2 parent thread의 child list 에 현재 thread 추가
@@ -251,7 +390,9 @@ thread_create (const char *name, int priority,
 
 	// create된 thread가 current thread보다 우선순위가 높다면
 	int curr_priority = thread_get_priority();
-	if (priority > curr_priority){
+	if (thread_fair)
+		test_highest_priority(); // fair는 vruntime 비교
+	else if (priority > curr_priority){
 		thread_yield(); // current thread cpu 양보
 	}
 
@@ -268,10 +409,28 @@ void
 thread_block (void) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
+	if (thread_fair)
+		fair_update_curr (); // block 전까지 실행한 시간 반영
 	thread_current ()->status = THREAD_BLOCKED;
+	sched_trace (SCHED_EV_BLOCK, thread_current (), 0);
 	schedule ();
 }
 
+/* Like thread_block(), for a thread that holds LOCK, the spinlock
+   that protects the wait queue it just put itself on.  LOCK stays
+   held until the thread is off its CPU and is released by the
+   thread that runs next, so that a waker, which needs LOCK to find
+   this thread, cannot unblock it while it is still running.
+   Returns without LOCK held. */
+void
+thread_block_spin (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (switch_lock == NULL);
+
+	switch_lock = lock;
+	thread_block ();
+}
+
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
@@ -289,10 +448,14 @@ thread_unblock (struct thread *t) {
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
 	
-	list_insert_ordered (&ready_list, &t->elem, thr_cmp_priority, NULL);
-	// priority에 따라 ready list에 insert // list_push_back (&ready_list, &t->elem);
+	if (thread_mlfqs)
+		mlfqs_refresh (t); // block 동안 놓친 decay 반영
+	if (thread_fair)
+		fair_place (t); // 오래 잔 thread는 제한된 만큼만 credit
+	ready_queue_push (t); // priority에 해당하는 ready queue 뒤에 insert
 
 	t->status = THREAD_READY;
+	sched_trace (SCHED_EV_UNBLOCK, t, running_thread ()->tid);
 	intr_set_level (old_level);
 }
 
@@ -335,10 +498,12 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	malloc_thread_exit ();
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	sched_trace (SCHED_EV_EXIT, thread_current (), 0);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -353,8 +518,13 @@ thread_yield (void) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	if (curr != idle_thread)
-		list_insert_ordered(&ready_list, &curr->elem, thr_cmp_priority, NULL); // ready_list 넣을때 순서대로
+	if (curr != idle_thread) {
+		if (thread_mlfqs)
+			mlfqs_refresh (curr);
+		if (thread_fair)
+			fair_update_curr ();
+		ready_queue_push (curr); // 같은 priority 안에서는 round-robin
+	} // 같은 priority 안에서는 round-robin
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -368,7 +538,7 @@ thread_set_priority (int new_priority) {
 
 	thread_current ()-> init_priority = new_priority;
 
-	update_priority(); // 바뀐  init_priority와 donation_list로 priority 결정(update)
+	update_priority(); // 바뀐 init_priority와 held_locks로 priority 결정(update)
 
 	test_highest_priority(); // priority 바뀐 후 가장 높은 priority인지 확인
 }
@@ -385,7 +555,8 @@ thread_set_nice (int nice UNUSED) {
 	/* TODO: Your implementation goes here */
 	enum intr_level old_level = intr_disable();
 	thread_current() -> nice = nice;
-	cal_priority(thread_current());
+	if (!thread_fair) // fair는 nice가 weight만 바꿈
+		cal_priority(thread_current());
 	test_highest_priority();
 	intr_set_level(old_level);
 	
@@ -440,8 +611,25 @@ idle (void *idle_started_ UNUSED) {
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
+		timer_idle_exit ();
 		thread_block ();
 
+		/* Nothing else to run, so zero free pages for later
+		   PAL_ZERO allocations.  An interrupt that readies another
+		   thread preempts us as usual, but one that readies a
+		   thread without yielding must neither wait for the rest
+		   of the zeroing nor for the hlt below. */
+		intr_enable ();
+		while (ready_cnt == 0 && palloc_prezero ())
+			continue;
+		intr_disable ();
+		if (ready_cnt > 0)
+			continue;
+
+		/* Nothing else to run, so stop the periodic tick until the
+		   next timer event if "-tickless" was given. */
+		timer_idle_enter ();
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -463,6 +651,7 @@ static void
 kernel_thread (thread_func *function, void *aux) {
 	ASSERT (function != NULL);
 
+	switch_finish ();
 	intr_enable ();       /* The scheduler runs with interrupts off. */
 	function (aux);       /* Execute the thread function. */
 	thread_exit ();       /* If function() returns, kill the thread. */
@@ -487,11 +676,16 @@ init_thread (struct thread *t, const char *name, int priority) {
 	// priority donation 관련
 	t->init_priority = priority;
 	t->wait_on_lock = NULL;
-	list_init(&t->donation_list);
+	list_init(&t->held_locks);
+	t->wait_on_sema = NULL;
 
 	// advanced scheduler
 	t-> nice = NICE_DEFAULT;
 	t-> recent_cpu = RECENT_CPU_DEFAULT;
+	t-> recent_cpu_epoch = mlfqs_epoch;
+
+	// fair scheduler: 새 thread는 지금까지 가장 적게 실행한 thread와 같은 위치에서 시작
+	t->vruntime = fair_min_vruntime;
 
 #ifdef USERPROG
 	// 2-3-fork 변수 초기화
@@ -511,10 +705,105 @@ init_thread (struct thread *t, const char *name, int priority) {
    idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
+	if (ready_cnt == 0)
 		return idle_thread;
 	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+		return ready_queue_pop ();
+}
+
+/* Appends T to the back of the ready queue for its priority.
+   Under the fair scheduler, inserts T into the vruntime heap
+   instead. */
+static void
+ready_queue_push (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	if (thread_fair) {
+		heap_insert (&fair_queue, &t->fair_elem);
+		fair_load += fair_weight (t);
+		ready_cnt++;
+		return;
+	}
+
+	list_push_back (&ready_queues[t->priority], &t->elem);
+	ready_bitmap |= 1ULL << t->priority;
+	ready_cnt++;
+}
+
+/* Removes T from its ready queue.  T's priority must not have
+   changed since it was pushed. */
+static void
+ready_queue_remove (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status == THREAD_READY);
+
+	if (thread_fair) {
+		heap_remove (&fair_queue, &t->fair_elem);
+		fair_load -= fair_weight (t);
+		ready_cnt--;
+		return;
+	}
+
+	list_remove (&t->elem);
+	if (list_empty (&ready_queues[t->priority]))
+		ready_bitmap &= ~(1ULL << t->priority);
+	ready_cnt--;
+}
+
+/* Removes and returns the front thread of the highest non-empty
+   ready queue, or under the fair scheduler the thread with the
+   least vruntime.  The ready queues must not be empty. */
+static struct thread *
+ready_queue_pop (void) {
+	int pri = ready_queue_highest ();
+	struct thread *t;
+
+	if (thread_fair) {
+		t = heap_entry (heap_pop (&fair_queue), struct thread, fair_elem);
+		fair_load -= fair_weight (t);
+		ready_cnt--;
+		return t;
+	}
+
+	ASSERT (pri >= PRI_MIN);
+	t = list_entry (list_pop_front (&ready_queues[pri]), struct thread, elem);
+	if (list_empty (&ready_queues[pri]))
+		ready_bitmap &= ~(1ULL << pri);
+	ready_cnt--;
+	return t;
+}
+
+/* Returns the highest priority that has a ready thread, or -1 if
+   no thread is ready. */
+static int
+ready_queue_highest (void) {
+	if (ready_bitmap == 0)
+		return -1;
+	return 63 - __builtin_clzll (ready_bitmap);
+}
+
+/* Sets T's priority to PRIORITY.  If T is in a ready queue, it is
+   moved to the back of the queue for its new priority; if T waits
+   on a semaphore, it is moved within that semaphore's waiters. */
+static void
+set_thread_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	if (t->priority == priority)
+		return;
+
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY) {
+		ready_queue_remove (t);
+		t->priority = priority;
+		ready_queue_push (t);
+	} else {
+		t->priority = priority;
+		if (t->status == THREAD_BLOCKED && t->wait_on_sema != NULL)
+			sema_reposition_waiter (t->wait_on_sema, t);
+	}
+	intr_set_level (old_level);
 }
 
 /* Use iretq to launch the thread */
@@ -625,7 +914,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_put (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -644,6 +933,8 @@ schedule (void) {
 
 	/* Start new time slice. */
 	thread_ticks = 0;
+	if (thread_fair)
+		next->exec_start = rdtsc ();
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -663,10 +954,26 @@ schedule (void) {
 			list_push_back (&destruction_req, &curr->elem);
 		}
 
+		sched_trace (SCHED_EV_SWITCH, next, curr->tid);
+
 		/* Before switching the thread, we first save the information
 		 * of current running. */
 		thread_launch (next);
 	}
+	switch_finish ();
+}
+
+/* Releases the spinlock that the thread switched away from handed
+   over in thread_block_spin(), if there is one.  Called by the
+   thread switched to, before it turns interrupts back on. */
+static void
+switch_finish (void) {
+	struct spinlock *lock = switch_lock;
+
+	if (lock != NULL) {
+		switch_lock = NULL;
+		spinlock_release (lock);
+	}
 }
 
 /* Returns a tid to use for a new thread. */
@@ -682,6 +989,38 @@ allocate_tid (void) {
 	return tid;
 }
 
+/* Returns a page for a new thread, preferring one recycled from
+   a dead thread.  Only the struct thread at the bottom of the
+   page needs to be zero, and init_thread() takes care of that,
+   so neither path zeroes the whole page.  Returns a null pointer
+   if no memory is available. */
+static struct thread *
+thread_page_get (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (thread_page_cache_cnt > 0)
+		t = thread_page_cache[--thread_page_cache_cnt];
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Releases the page of dead thread T, keeping it in the cache
+   if there is room.  Interrupts must be off. */
+static void
+thread_page_put (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_page_cache_cnt < THREAD_PAGE_CACHE_MAX)
+		thread_page_cache[thread_page_cache_cnt++] = t;
+	else
+		palloc_free_page (t);
+}
+
 /* next_wakeup_tick 이 ticks 보다 크면 ticks로 update*/
 void
 update_next_wakeup_tick(int64_t ticks){
@@ -700,6 +1039,8 @@ get_next_wakeup_tick(void){
 void
 sleep_thread(int64_t ticks){
 	struct thread *curr;
+	int64_t slot_tick;
+	int slot;
 
 	// inturrupt 금지, 이전 intr_level 저장
 	enum intr_level old_level;
@@ -709,32 +1050,78 @@ sleep_thread(int64_t ticks){
 	ASSERT (curr != idle_thread); // idle thread -> sleep 되면 안됨
 
 	curr -> wakeup_tick = ticks; // curr thread의 wakeup_tick에 ticks 저장
-	update_next_wakeup_tick(ticks); //next_wakeup_tick update;
+	sched_trace (SCHED_EV_SLEEP, curr, ticks);
 
-	list_push_back(&sleep_list, &curr->elem); //curr thread sleep_list에 삽입 후 스케쥴
+	// 이미 지나간 tick이면 다음에 처리할 bucket에 넣기
+	slot_tick = ticks > sleep_wheel_tick ? ticks : sleep_wheel_tick + 1;
+	slot = slot_tick & SLEEP_WHEEL_MASK;
+	list_push_back(&sleep_wheel[slot], &curr->elem); //curr thread를 wheel에 삽입 후 스케쥴
+	sleep_wheel_bitmap[slot / 64] |= 1ULL << (slot % 64);
+	update_next_wakeup_tick(slot_tick); //next_wakeup_tick update;
 
 	thread_block(); //이 스레드 블락
 
 	intr_set_level(old_level); //intr_level 원래로 
 }
 
+/* FROM 이후(포함) 처음으로 비어있지 않은 bucket의 tick 반환.
+   wheel이 비어있으면 INT64_MAX. */
+static int64_t
+sleep_wheel_next (int64_t from) {
+	int start = from & SLEEP_WHEEL_MASK;
+
+	for (int i = 0; i <= SLEEP_WHEEL_SIZE / 64; i++) {
+		int word = (start / 64 + i) % (SLEEP_WHEEL_SIZE / 64);
+		uint64_t bits = sleep_wheel_bitmap[word];
+
+		if (i == 0)
+			bits &= ~0ULL << (start % 64); // start 이전 bit 제외
+		else if (i == SLEEP_WHEEL_SIZE / 64)
+			bits &= (1ULL << (start % 64)) - 1; // 한바퀴 돌아온 word는 start 이전만
+		if (bits != 0) {
+			int slot = word * 64 + __builtin_ctzll (bits);
+			return from + ((slot - start) & SLEEP_WHEEL_MASK);
+		}
+	}
+	return INT64_MAX;
+}
+
 // ticks시각에 일어날 thread 모두 awake 하는 함수
 void
 awake_thread(int64_t ticks){
-	next_wakeup_tick = INT64_MAX;
-	struct list_elem *e = list_begin(&sleep_list); //sleep_list 처음 elem 가져오기
-
-	while (e!= list_end(&sleep_list)){
- 		struct thread *t = list_entry(e, struct thread, elem);
-
-		if (ticks >= t-> wakeup_tick){ // ticks 보다 thread의 wakeup_tick 작으면
-			e = list_remove(&t -> elem); // sleep_list에서 제거후 다음 elem
-			thread_unblock(t); // t는 unblock
-		} else {
-			e = list_next(e); // 다음 elem
-			update_next_wakeup_tick(t -> wakeup_tick); // next_wakeup_tick을 t의 wakeup_tick으로 update
+	int64_t start = sleep_wheel_tick;
+
+	// 마지막 처리 tick 이후 비어있지 않은 bucket만 차례대로 (최대 한바퀴)
+	while (sleep_wheel_tick < ticks) {
+		int64_t tick = sleep_wheel_next(sleep_wheel_tick + 1);
+		if (tick > ticks || tick - start > SLEEP_WHEEL_SIZE) {
+			sleep_wheel_tick = ticks;
+			break;
+		}
+
+		int slot = tick & SLEEP_WHEEL_MASK;
+		struct list *bucket = &sleep_wheel[slot];
+		struct list_elem *e = list_begin(bucket);
+		while (e != list_end(bucket)){
+			struct thread *t = list_entry(e, struct thread, elem);
+
+			if (ticks >= t-> wakeup_tick){ // ticks 보다 thread의 wakeup_tick 작으면
+				e = list_remove(&t -> elem); // bucket에서 제거후 다음 elem
+				sched_trace (SCHED_EV_WAKE, t, ticks);
+				thread_unblock(t); // t는 unblock
+			} else
+				e = list_next(e); // 다음 바퀴에 일어날 thread
 		}
+		if (list_empty(bucket))
+			sleep_wheel_bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+		sleep_wheel_tick = tick;
 	}
+
+	next_wakeup_tick = sleep_wheel_next(sleep_wheel_tick + 1);
+
+	// fair: 깨어난 thread가 running thread보다 한 tick 넘게 덜 실행했으면 다음 tick까지 기다리지 않음
+	if (thread_fair && intr_context() && fair_should_preempt(fair_tick_cycles))
+		intr_yield_on_return();
 }
 
 // x가 y보다 우선순위 높은지 반환
@@ -745,99 +1132,110 @@ thr_cmp_priority (const struct list_elem *x, const struct list_elem *y, void *au
 	return (priority_x > priority_y);
 }
 
-// current thread와 ready_list의 높은 순위 thread 비교해서 yield 결정
+// current thread와 ready queue의 가장 높은 priority 비교해서 yield 결정
+// fair는 vruntime이 가장 작은 ready thread가 한 tick 이상 덜 실행했으면 yield
 void
 test_highest_priority (void){ 
-	if (!list_empty(&ready_list)){
-		struct thread *highest_ready = list_entry(list_front(&ready_list), struct thread, elem);
-		int curr_priority = thread_get_priority();
-		if (curr_priority < highest_ready -> priority){
+	if (thread_fair) {
+		enum intr_level old_level = intr_disable ();
+		bool preempt = fair_should_preempt (fair_tick_cycles);
+		intr_set_level (old_level);
+		if (preempt)
 			thread_yield();
-		}
+		return;
 	}
-}
 
-// donation
-//donation_elem 이용하여 스레드의 우선도 비교 함수
-bool
-thr_donation_cmp_priority (const struct list_elem *x, const struct list_elem *y, void *aux UNUSED){ 
-	int priority_x = list_entry(x, struct thread, donation_elem) -> priority;
-	int priority_y = list_entry(y, struct thread, donation_elem) -> priority;
-	return (priority_x > priority_y);
+	int highest_ready = ready_queue_highest(); // ready_bitmap의 최상위 bit
+	if (highest_ready >= 0 && thread_get_priority() < highest_ready){
+		thread_yield();
+	}
 }
 
-//priority donate (nested)
+// donation
+// curr가 기다리는 lock의 holder부터 wait_on_lock chain 끝까지 priority donate
+// holder의 priority가 이미 높으면 그 뒤로는 바뀔 것이 없으므로 멈춤
 void
 donate_priority(void) {
+	enum intr_level old_level = intr_disable ();
 	struct thread *t = thread_current();
-	
-	for (int i = 0; i < 8; i++){ //depth = 8
-		if (t->wait_on_lock == NULL) break; // wait_on_lock 더이상 없으면 for문 나오기
+	int priority = t->priority;
+
+	while (t->wait_on_lock != NULL){ // depth 제한 없음
 		struct thread *lock_holder = t->wait_on_lock->holder;
-		lock_holder -> priority = t -> priority; // priority donate
+		if (lock_holder == NULL || lock_holder->priority >= priority)
+			break;
+		set_thread_priority(lock_holder, priority); // priority donate (ready/대기 위치 이동)
+		sched_trace (SCHED_EV_DONATE, lock_holder, thread_current ()->tid);
 		t = lock_holder; // lock_holder의 wait_on_lock 확인해서 donate 해주기
 	}
-	
-}
-
-// cur_thread의 donation_list에서 lock에 해당된 thread remove
-void
-remove_with_lock_in_donation_list(struct lock *lock){
-	struct thread *curr = thread_current();
-
-	struct list_elem *e;
-	for (e = list_begin(&curr->donation_list); e != list_end(&curr->donation_list); e = list_next(e)){ // donation_list 에서 lock 풀린거 찾기
-		struct thread *t = list_entry(e, struct thread, donation_elem);
-		if (t->wait_on_lock == lock) // donations에서 이 lock 풀리기 기다리는 스레드면
-			list_remove(e); // donations에서 e(donation_elem)를 삭제
-	}
-
+	intr_set_level (old_level);
 }
 
-// donation 끝났으니 priority 재설정
+// priority를 init_priority와 가지고 있는 lock들의 waiter heap top 중 max로 재설정
+// lock마다 top은 O(1)이라 waiter 수와 상관없음
 void
 update_priority (void) {
 	struct thread *curr = thread_current();
+	int priority = curr->init_priority; // 원래 priority
+	struct list_elem *e;
 
-	// 원래 priority로 되돌림
-	curr -> priority = curr -> init_priority; 
-
-	// donation_list 에 donation_elem 있으면
-	if (!list_empty(&curr->donation_list)) {
-		list_sort (&curr->donation_list, thr_donation_cmp_priority, NULL); // sort
-
-		struct thread *high = list_entry(list_front(&curr->donation_list), struct thread, donation_elem); // 우선순위 높은것(첫번째) 뽑아서
-
-		if (high -> priority > curr -> priority){ // high의 priority가 더 크면 donation 받음
-			curr -> priority = high -> priority;
-		}
-
-
+	for (e = list_begin(&curr->held_locks); e != list_end(&curr->held_locks); e = list_next(e)){
+		struct lock *lock = list_entry(e, struct lock, elem);
+		int donated = sema_highest_priority(&lock->semaphore);
+		if (donated > priority) // waiter의 priority가 더 크면 donation 받음
+			priority = donated;
 	}
-
+	curr->priority = priority;
 }
 
 // advanced scheduler
+// recent_cpu, nice로 계산한 priority (PRI_MIN ~ PRI_MAX로 clamp)
+static int
+mlfqs_priority (struct thread *t) {
+	int priority = fp_to_n(add_fp_n(div_fp_n(t->recent_cpu, -4), PRI_MAX - t->nice * 2));
+	if (priority > PRI_MAX) priority = PRI_MAX;
+	if (priority < PRI_MIN) priority = PRI_MIN;
+	return priority;
+}
+
 void 
 cal_priority (struct thread *t) {
 	if (t == idle_thread) return;
-	t->priority = fp_to_n(add_fp_n(div_fp_n(t->recent_cpu, -4), PRI_MAX - t->nice * 2));
+	set_thread_priority(t, mlfqs_priority(t));
 }
 
+// t가 놓친 epoch들의 decay를 순서대로 적용 (매초 모든 thread를 돌지 않기 위함)
 void
 cal_recent_cpu (struct thread *t) {
 	if (t == idle_thread) return;
-	t -> recent_cpu = add_fp_n(div_fp_fp(mul_fp_fp(mul_fp_n(load_avg, 2), t->recent_cpu), add_fp_n(mul_fp_n(load_avg, 2),1)), t->nice);
+
+	// history보다 오래 block 되어있었으면 남아있는 만큼만 적용
+	if (mlfqs_epoch - t->recent_cpu_epoch > DECAY_HISTORY)
+		t->recent_cpu_epoch = mlfqs_epoch - DECAY_HISTORY;
+
+	while (t->recent_cpu_epoch < mlfqs_epoch){
+		int twice_load_avg = decay_table[++t->recent_cpu_epoch % DECAY_HISTORY];
+		t -> recent_cpu = add_fp_n(div_fp_fp(mul_fp_fp(twice_load_avg, t->recent_cpu), add_fp_n(twice_load_avg, 1)), t->nice);
+	}
 }
 
 void
 cal_load_avg (void) {
-	int num_ready_threads = list_size(&ready_list);
+	int num_ready_threads = ready_cnt;
 
 	if (thread_current() != idle_thread)
 		num_ready_threads++;
 	
-	load_avg = add_fp_fp(mul_fp_fp(div_fp_n(n_to_fp(59),60),load_avg), div_fp_n(n_to_fp(num_ready_threads),60));
+	load_avg = add_fp_fp(mul_fp_fp(LOAD_AVG_DECAY, load_avg), div_fp_n(n_to_fp(num_ready_threads),60));
+}
+
+// ready queue에 들어가는 thread의 recent_cpu, priority를 최신으로
+static void
+mlfqs_refresh (struct thread *t) {
+	ASSERT (t->status != THREAD_READY);
+	if (t == idle_thread) return;
+	cal_recent_cpu(t);
+	t->priority = mlfqs_priority(t);
 }
 
 //running thread의 recent_cpu 1tick마다 1씩 증가
@@ -850,38 +1248,163 @@ running_thr_incr_recent_cpu (void){
 	
 }
 
-// all thread의 recent_cpu 재계산
+// 1초마다 load_avg 갱신하고 새 epoch 시작
+// blocked thread는 다시 ready queue에 들어갈 때 decay 적용
 void
-recal_all_recent_cpu (void){
-	struct list_elem *e;
+recal_per_second (void){
+	cal_load_avg();
+	mlfqs_epoch++;
+	decay_table[mlfqs_epoch % DECAY_HISTORY] = mul_fp_n(load_avg, 2);
 
 	cal_recent_cpu(thread_current());
+	cal_priority(thread_current());
 
-	for (e= list_begin(&ready_list); e != list_end(&ready_list); e=list_next(e)){
-		struct thread *t = list_entry(e, struct thread, elem);
-		cal_recent_cpu(t);
-	}
+	// ready thread 재정렬은 ready thread 수에 비례하므로 interrupt 밖(kworker)에서
+	work_queue(&mlfqs_resort_work);
+}
 
-	for (e= list_begin(&sleep_list); e != list_end(&sleep_list); e=list_next(e)){
-		struct thread *t = list_entry(e, struct thread, elem);
-		cal_recent_cpu(t);
+// ready queue의 thread들에 새 epoch의 recent_cpu, priority 적용 (kworker에서 실행)
+// interrupt를 끄는 시간이 ready thread 수에 비례하지 않도록 MLFQS_RESORT_BATCH개씩 처리
+static void
+mlfqs_resort (void *aux UNUSED) {
+	int pri = PRI_MAX;
+	int64_t epoch = mlfqs_epoch;
+
+	while (pri >= PRI_MIN) {
+		enum intr_level old_level = intr_disable();
+		int batch = 0;
+
+		// batch 사이에 epoch이 바뀌었으면 처음 queue부터 다시
+		if (epoch != mlfqs_epoch){
+			epoch = mlfqs_epoch;
+			pri = PRI_MAX;
+		}
+		while (pri >= PRI_MIN && batch < MLFQS_RESORT_BATCH){
+			struct list *q = &ready_queues[pri];
+			struct thread *t;
+
+			// queue 앞쪽의 갱신 안 된 thread만, 갱신된 thread가 나오면 다음 queue
+			if (list_empty(q)
+					|| (t = list_entry(list_front(q), struct thread, elem))
+						->recent_cpu_epoch == mlfqs_epoch){
+				pri--;
+				continue;
+			}
+			// priority가 그대로여도 queue 뒤로 보내서 앞쪽에 갱신 안 된 thread만 남게
+			ready_queue_remove(t);
+			if (t != idle_thread){
+				cal_recent_cpu(t);
+				t->priority = mlfqs_priority(t);
+			} else
+				t->recent_cpu_epoch = mlfqs_epoch;
+			ready_queue_push(t);
+			batch++;
+		}
+		intr_set_level(old_level);
 	}
 }
 
-// all thread의 priority 재계산
-void
-recal_all_priority(void){
-	struct list_elem *e;
+// fair scheduler
+// heap top이 vruntime 가장 작은 thread가 되도록 (같으면 먼저 들어온 쪽)
+static bool
+fair_less (const struct heap_elem *a_, const struct heap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, fair_elem);
+	const struct thread *b = heap_entry (b_, struct thread, fair_elem);
+	return a->vruntime > b->vruntime;
+}
 
-	cal_priority(thread_current());
+static int
+fair_weight (const struct thread *t) {
+	int nice = t->nice;
+	if (nice < NICE_MIN) nice = NICE_MIN;
+	if (nice > NICE_MAX) nice = NICE_MAX;
+	return fair_weights[nice - NICE_MIN];
+}
 
-	for (e= list_begin(&ready_list); e != list_end(&ready_list); e=list_next(e)){
-		struct thread *t = list_entry(e, struct thread, elem);
-		cal_priority(t);
+// running thread가 exec_start 이후 실행한 cycle을 weight로 나눠 vruntime에 반영
+static void
+fair_update_curr (void) {
+	struct thread *curr = running_thread ();
+	uint64_t now = rdtsc ();
+	int64_t min;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (curr == idle_thread)
+		return;
+
+	if (curr->exec_start != 0)
+		curr->vruntime += (now - curr->exec_start) * NICE_0_WEIGHT / fair_weight (curr);
+	curr->exec_start = now;
+
+	// min_vruntime은 running thread와 heap top 중 작은 값을 따라가되 줄어들지 않음
+	min = curr->vruntime;
+	if (!heap_empty (&fair_queue)) {
+		struct thread *first = heap_entry (heap_top (&fair_queue), struct thread, fair_elem);
+		if (first->vruntime < min)
+			min = first->vruntime;
 	}
+	if (min > fair_min_vruntime)
+		fair_min_vruntime = min;
+}
+
+// 깨어나는 T의 vruntime 조정: 자는 동안 쌓인 credit은 latency 절반까지만 인정
+static void
+fair_place (struct thread *t) {
+	int64_t credit = fair_tick_cycles * FAIR_LATENCY_TICKS / 2;
+	int64_t floor = fair_min_vruntime - credit;
+
+	if (t->vruntime < floor)
+		t->vruntime = floor;
+}
+
+// running thread의 vruntime이 heap top보다 GRANULARITY 넘게 앞서면 true
+// idle thread는 ready thread가 있으면 항상 양보
+static bool
+fair_should_preempt (int64_t granularity) {
+	struct thread *curr = running_thread ();
+	struct thread *first;
 
-	for (e= list_begin(&sleep_list); e != list_end(&sleep_list); e=list_next(e)){
-		struct thread *t = list_entry(e, struct thread, elem);
-		cal_priority(t);
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (heap_empty (&fair_queue))
+		return false;
+	if (curr == idle_thread)
+		return true;
+
+	fair_update_curr ();
+	first = heap_entry (heap_top (&fair_queue), struct thread, fair_elem);
+	return curr->vruntime - first->vruntime > granularity;
+}
+
+// 매 tick 호출 (interrupt context). tick 길이를 추정하고,
+// running thread가 자기 slice를 다 썼거나 훨씬 덜 실행한 thread가 있으면 true
+static bool
+fair_tick (void) {
+	struct thread *curr = running_thread ();
+	uint64_t now = rdtsc ();
+	uint64_t delta = now - fair_last_tick;
+	int64_t slice;
+
+	// tick 길이는 연속된 tick 사이의 TSC 차이의 이동 평균
+	// (tickless로 건너뛴 tick처럼 튀는 값은 무시)
+	if (fair_last_tick != 0) {
+		if (fair_tick_cycles == 0)
+			fair_tick_cycles = delta;
+		else if (delta < fair_tick_cycles * 2)
+			fair_tick_cycles += ((int64_t) delta - (int64_t) fair_tick_cycles) / 8;
 	}
-}
\ No newline at end of file
+	fair_last_tick = now;
+
+	if (curr == idle_thread)
+		return !heap_empty (&fair_queue);
+
+	// slice = latency * 내 weight / (ready 전체 weight + 내 weight)
+	slice = FAIR_LATENCY_TICKS * fair_weight (curr) / (fair_load + fair_weight (curr));
+	if (slice < FAIR_MIN_SLICE)
+		slice = FAIR_MIN_SLICE;
+	if (++thread_ticks >= slice)
+		return !heap_empty (&fair_queue);
+
+	// 깨어난 thread가 나보다 한 slice 넘게 덜 실행했으면 기다리지 않고 양보
+	return fair_should_preempt (fair_tick_cycles * slice);
+}
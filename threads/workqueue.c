@@ -0,0 +1,78 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Pending work, oldest first. */
+static struct list work_list;
+
+/* Upped once for each item added to work_list. */
+static struct semaphore work_sema;
+
+static thread_func worker;
+
+/* Starts the worker thread.  Must be called after
+   thread_start(). */
+void
+workqueue_init (void) {
+	list_init (&work_list);
+	sema_init (&work_sema, 0);
+	if (thread_create ("kworker", PRI_MAX, worker, NULL) == TID_ERROR)
+		PANIC ("couldn't start work queue thread");
+}
+
+/* Initializes W to call FUNC with AUX when it runs. */
+void
+work_init (struct work *w, work_func *func, void *aux) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+
+	w->func = func;
+	w->aux = aux;
+	w->pending = false;
+}
+
+/* Queues W to run in the worker thread.  Returns false, without
+   doing anything, if W is already pending.  May be called from an
+   interrupt handler. */
+bool
+work_queue (struct work *w) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	old_level = intr_disable ();
+	if (!w->pending) {
+		w->pending = true;
+		list_push_back (&work_list, &w->elem);
+		sema_up (&work_sema);
+		if (intr_context ())
+			intr_yield_on_return ();
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Runs queued work, one item per wakeup. */
+static void
+worker (void *aux UNUSED) {
+	/* The schedulers that ignore priorities still have to run us
+	   ahead of everything else. */
+	if (thread_mlfqs || thread_fair)
+		thread_set_nice (-20);
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *w;
+
+		sema_down (&work_sema);
+
+		old_level = intr_disable ();
+		w = list_entry (list_pop_front (&work_list), struct work, elem);
+		w->pending = false;
+		intr_set_level (old_level);
+
+		w->func (w->aux);
+	}
+}
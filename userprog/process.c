@@ -161,6 +161,12 @@ __do_fork (void *aux) {
 
 	process_activate (current);
 #ifdef VM
+	// 실행 파일도 복제, 자식의 code page는 이걸 가리킴 (부모가 먼저 끝나도 됨)
+	if (parent->running_file != NULL){
+		current->running_file = file_duplicate (parent->running_file);
+		if (current->running_file == NULL)
+			goto error;
+	}
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
@@ -184,7 +190,7 @@ __do_fork (void *aux) {
 			goto error;
 		}
 		
-		struct fd_list_elem *dup = (struct fd_list_elem *) malloc(sizeof(struct fd_list_elem));
+		struct fd_list_elem *dup = kmem_cache_alloc (fd_elem_cachep);
 
 		if (dup == NULL){
 			goto error;
@@ -368,11 +374,10 @@ process_exit (void) {
 	while (!list_empty(curr->fd_list)){
 		struct fd_list_elem *tmp = list_entry(list_pop_front(curr->fd_list), struct fd_list_elem, elem);
 		file_close(tmp->file_ptr);
-		free(tmp); //malloc 한거 free
+		kmem_cache_free(fd_elem_cachep, tmp); // open 때 할당한거 free
 	}
 	file_close(curr->running_file);
 	curr->running_file = NULL;
-	free(curr->fd_list);
 
 	//2. orphan 고려 , child_list에서 빼기, 자식들 parent 삭제
 	while (!list_empty(&curr->child_list)){
@@ -808,43 +813,18 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		/* Do calculate how to fill this page.
-		 * We will read PAGE_READ_BYTES bytes from FILE
-		 * and zero the final PAGE_ZERO_BYTES bytes. */
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
+	/* TODO: Set up aux to pass information to the lazy_load_segment. */
+	// P3-2-2 load_segment 함수 구현
+	// project 2에선 바로 로드 했음 but project3에선 lazy_loading
+	// segment 전체를 VMA 하나로 기록, page는 처음 fault 날때 만들어짐
 
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		// P3-2-2 load_segment 함수 구현
-		// project 2에선 바로 로드 했음 but project3에선
-		// lazy_loading 구현 위해서 vm_alloc_page_with_initaializer 함수 호출
-		// 이때 aux로 필요한 정보 넘겨주기
-
-		// aux 설정
-		struct page_load_info *aux = (struct page_load_info *) malloc(sizeof(struct page_load_info));
-		aux->file = file;
-		aux->ofs = ofs;
-		aux->read_bytes = page_read_bytes;
-		aux->zero_bytes = page_zero_bytes;
-
-		// ofs 업데이트
-		ofs += page_read_bytes;
-		// printf("%d\n", ofs);
-
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux)){
-			//printf("load segment vm_alloc fail\n");
-			return false;
-		}
-			
-
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
+	// 쓰기 금지 code segment는 page cache 통해서 같은 binary끼리 frame 공유
+	if (!writable){
+		return file_map_text (upage, read_bytes + zero_bytes, file, ofs,
+				read_bytes);
 	}
-	return true;
+	return vm_map_range (upage, read_bytes + zero_bytes, VM_ANON, writable,
+			file, ofs, read_bytes, lazy_load_segment) != NULL;
 }
 
 /* Create a PAGE of stack at the USER_STACK. Return true on success. */
@@ -859,22 +839,17 @@ setup_stack (struct intr_frame *if_) {
 	/* TODO: Your code goes here */
 	// P3-2-4 setup stack 수정
 	// 첫번째 stack은 lazy loading 필요 없음. 바로 alloc, claim 호출
-	bool alloc_succ = vm_alloc_page(VM_ANON|VM_MARKER_0, stack_bottom, true);
-	if (!alloc_succ){
-		// 에러나면 페이지 탐색 후 메모리 해제
-		struct page *fail_page = spt_find_page(&thread_current()->spt, stack_bottom);
-		palloc_free_page(fail_page);
+	// stack은 VMA로 기록, 아래로 자라면 stack growth에서 VMA를 늘림
+	if (vm_map_range(stack_bottom, PGSIZE, VM_ANON|VM_MARKER_0, true,
+				NULL, 0, 0, NULL) == NULL){
 		return false;
 	}
 
-	bool claim_succ = vm_claim_page(stack_bottom);
-	if (!claim_succ){
-		struct page *fail_page = spt_find_page(&thread_current()->spt, stack_bottom);
-		palloc_free_page(fail_page);
+	if (!vm_claim_page(stack_bottom)){
 		return false;
 	}
 
-	memset(stack_bottom, 0, PGSIZE);
+	// stack page는 vm_do_claim_page에서 0으로 채워진 frame을 받음
 	success = true;
 	if_->rsp = USER_STACK;
 
@@ -20,6 +20,8 @@
 #include "filesys/directory.h" // P4-4-3 추가
 #include "filesys/inode.h" // P4-4-3 추가
 
+struct kmem_cache *fd_elem_cachep;
+
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 // P2-3 System call 추가 함수
@@ -54,6 +56,8 @@ syscall_init (void) {
 	// P2-3 system call 
 	current_fd = 3;
 	lock_init(&syscall_lock); // synchronize lock 초기화
+	fd_elem_cachep = kmem_cache_create ("fd_list_elem",
+			sizeof (struct fd_list_elem), NULL);
 }
 
 /* The main system call interface */
@@ -284,7 +288,7 @@ int open (const char *file){
 	if (file_open == NULL){ //open 에러
 		return -1;
 	} else if (list_size(thread_current()->fd_list) <= 130) {
-		struct fd_list_elem *fd_elem = malloc(sizeof(struct fd_list_elem));
+		struct fd_list_elem *fd_elem = kmem_cache_alloc (fd_elem_cachep);
 
 		fd_elem -> fd = current_fd;
 		fd_elem -> file_ptr = file_open;
@@ -342,7 +346,8 @@ int read (int fd, void *buffer, unsigned size){
 
 		// P3 pt-write-code2 PASS 수정
 		#ifdef VM
-		if (spt_find_page(&thread_current()->spt, buffer) != NULL && spt_find_page(&thread_current()->spt, buffer)->writable == 0){
+		struct vma *vma = vma_find(&thread_current()->spt.vmas, buffer);
+		if (vma != NULL && !vma->writable){
 			exit(-1);
 		}
 		#endif
@@ -416,8 +421,8 @@ void close (int fd){
 		file_close(close_fd_list_elem->file_ptr);
 		lock_release(&syscall_lock);
 
-		// open 에서 malloc 했던거 free
-		free(close_fd_list_elem); 
+		// open 에서 할당했던거 free
+		kmem_cache_free(fd_elem_cachep, close_fd_list_elem);
 	}
 
 }
@@ -471,7 +476,12 @@ void *mmap (void *addr, size_t length, int writable, int fd, off_t offset){
 	}
 	// printf("do mmap before!\n");
 
-	return do_mmap(addr, length, writable, fd_file, offset);
+	// MAP_POPULATE면 mapping 전체를 지금 다 load
+	void *map = do_mmap(addr, length, writable & ~MAP_POPULATE, fd_file, offset);
+	if (map != NULL && (writable & MAP_POPULATE)){
+		vm_prefault(map, length);
+	}
+	return map;
 
 }
 
@@ -483,25 +493,7 @@ void munmap (void *addr){
 		return;
 	}
 
-	struct page *page = spt_find_page(&thread_current()->spt, addr);
-	// page를 찾을 수 없다면 -> addr로 된 page 없음 -> return
-	if ( page == NULL ){
-		// printf("pg_null\n");
-		return;
-	}
-
-	// page type VM_File 아니면 fail
-	// printf("vm_type: %d", page->operations->type);
-	if (page->operations->type != VM_FILE){
-		// printf("not vm file\n");
-		return;
-	}
-
-	// page가 첫번째가 아니면 fail
-	if (!page->file.is_first_page){
-		// printf("not first page\n");
-		return;
-	}
+	// addr에서 시작하는 mmap 영역이 아니면 do_munmap에서 무시
 	do_munmap(addr);
 }
 
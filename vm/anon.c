@@ -4,6 +4,8 @@
 #include "devices/disk.h"
 #include "threads/vaddr.h"
 #include "threads/mmu.h"
+#include "vm/zswap.h"
+#include <stdio.h>
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -22,6 +24,26 @@ static const struct page_operations anon_ops = {
 // P3-5-0 args_swap 변수 선언
 static struct args_swap anon_args_swap;
 
+/* A page takes this many swap disk sectors. */
+#define SECTORS_PER_PAGE (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Swap slots are handed out next-fit from SWAP_CURSOR, so that
+ * pages evicted one after another, and clusters of virtually
+ * adjacent pages, land in adjacent slots and can be read back with
+ * one request.  Protected by anon_args_swap.lock_swap. */
+static size_t swap_cursor;
+
+/* Statistics. */
+static long long swap_write_cnt;       /* Write requests. */
+static long long swap_out_page_cnt;    /* Pages written. */
+static long long swap_read_cnt;        /* Read requests. */
+static long long swap_in_page_cnt;     /* Pages read, faulted or not. */
+static long long swap_readahead_cnt;   /* Pages read ahead of a fault. */
+
+static bool swap_write_cluster (struct page *pages[], size_t cnt);
+static size_t swap_slot_alloc (size_t cnt);
+static void swap_slot_free (size_t slot, size_t cnt);
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
@@ -36,6 +58,9 @@ vm_anon_init (void) {
 
 	// lock_init
 	lock_init(&anon_args_swap.lock_swap);
+
+	if (zswap_enabled)
+		zswap_init();
 }
 
 /* Initialize the file mapping */
@@ -48,76 +73,238 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 
 	// P3-5-2 anon_initializer 수정 - num_swap_table 초기화(-1로 초기화)
 	anon_page->num_swap_table = -1;
+	anon_page->zentry = NULL;
 	return true;
 }
 
-/* Swap in the page by read contents from the swap disk. */
+/* Swap in the page by read contents from the swap disk.
+ * The anon pages at the following virtual addresses whose contents
+ * sit in the following swap slots are read in the same request and
+ * mapped too, as long as free frames are at hand. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
 	// P3-5-4 anon_swap_in 구현
-	
-	int sect_size = PGSIZE / 8;
-	size_t idx = anon_page->num_swap_table;
+	struct page *pages[SWAP_CLUSTER_MAX];
+	struct frame *frames[SWAP_CLUSTER_MAX];
+	void *sectors[SWAP_CLUSTER_MAX * SECTORS_PER_PAGE];
+	size_t idx;
+	size_t cnt, i;
+
+	// zswap에 압축해 둔 page면 disk 안 거치고 풀기
+	if (zswap_load(page, kva))
+		return true;
 
+	idx = anon_page->num_swap_table;
 	if (bitmap_test(anon_args_swap.swap_table, idx) == false){
 		PANIC("anon_swap_in NOT in swap_table");
 		return false;
 	}
-	
-	// sector read 하기
-	for (int i = 0 ; i < 8; i++){
-		void *addr = page->frame->kva + sect_size * i;
-		disk_read(swap_disk, 8*idx+i, addr);
+
+	// readahead: 다음 va의 page가 다음 slot에 있으면 같이 읽기
+	// 남는 frame이 있을 때만 (evict 해가면서 readahead 하지는 않음)
+	pages[0] = page;
+	for (cnt = 1; cnt < SWAP_CLUSTER_MAX; cnt++){
+		struct page *next = spt_find_page(&thread_current()->spt,
+				page->va + cnt * PGSIZE);
+		if (next == NULL || next->operations != &anon_ops
+				|| next->frame != NULL
+				|| next->anon.num_swap_table != (int) (idx + cnt))
+			break;
+		frames[cnt] = vm_frame_alloc_noevict();
+		if (frames[cnt] == NULL)
+			break;
+		pages[cnt] = next;
+	}
+
+	// sector read 하기, cluster 전체를 한번에
+	for (i = 0; i < cnt * SECTORS_PER_PAGE; i++){
+		void *base = i < SECTORS_PER_PAGE ? kva : frames[i / SECTORS_PER_PAGE]->kva;
+		sectors[i] = base + DISK_SECTOR_SIZE * (i % SECTORS_PER_PAGE);
 	}
+	disk_readv(swap_disk, SECTORS_PER_PAGE * idx, sectors, cnt * SECTORS_PER_PAGE);
+	swap_read_cnt++;
+	swap_in_page_cnt++;
 
 	// swap_table 수정
-	bitmap_set_multiple(anon_args_swap.swap_table, idx, 1, false);
+	swap_slot_free(idx, 1);
+	anon_page->num_swap_table = -1;
+
+	// readahead 한 page들도 mapping, accessed bit 0이라 안 쓰면 먼저 evict됨
+	for (i = 1; i < cnt; i++){
+		if (vm_frame_map(pages[i], frames[i])){
+			swap_slot_free(idx + i, 1);
+			pages[i]->anon.num_swap_table = -1;
+			vm_frame_unpin(frames[i]);
+			swap_in_page_cnt++;
+			swap_readahead_cnt++;
+		} else {
+			vm_frame_free(frames[i]);
+		}
+	}
 
 	return true;
 }
 
+/* Copies the contents of SRC, a swapped-out anon page of another
+ * process, into the page at KVA.  SRC stays where it is.  Used by
+ * fork, while SRC's owner waits. */
+void
+anon_copy_swapped (struct page *src, void *kva) {
+	void *sectors[SECTORS_PER_PAGE];
+	size_t i;
+
+	if (zswap_copy(src, kva))
+		return;
+
+	for (i = 0; i < SECTORS_PER_PAGE; i++)
+		sectors[i] = kva + DISK_SECTOR_SIZE * i;
+	disk_readv(swap_disk, SECTORS_PER_PAGE * src->anon.num_swap_table,
+			sectors, SECTORS_PER_PAGE);
+	swap_read_cnt++;
+}
+
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
 	// P3-5-3 anon_swap_out 구현
-	
-	// swap_table에서 bit 0인곳 찾기
+	return anon_swap_out_cluster(&page, 1);
+}
+
+/* Swaps out the CNT anon pages in PAGES, which must map
+ * consecutive virtual pages of one process, or all share one frame
+ * copy-on-write and each get a copy of it.  With zswap, each page
+ * is compressed into the zswap pool if it can be.  The others go
+ * into CNT consecutive swap slots with a single disk request.
+ * Their frames must be pinned and unmapped by the evictor, which
+ * unlinks the pages from them afterward. */
+bool
+anon_swap_out_cluster (struct page *pages[], size_t cnt) {
+	size_t i;
+
+	ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER_MAX);
+
+	if (!zswap_enabled)
+		return swap_write_cluster(pages, cnt);
+
+	// 매핑은 evict 하는 쪽에서 이미 지워서 압축하는 동안 바뀌지 않음
+	for (i = 0; i < cnt; i++)
+		if (!zswap_store(pages[i]) && !swap_write_cluster(&pages[i], 1))
+			return false;
+	return true;
+}
+
+/* Writes the CNT anon pages in PAGES, laid out as for
+ * anon_swap_out_cluster(), into CNT consecutive swap slots
+ * with a single disk request.  Falls back to one request per page
+ * if there is no run of CNT free slots. */
+static bool
+swap_write_cluster (struct page *pages[], size_t cnt) {
+	const void *sectors[SWAP_CLUSTER_MAX * SECTORS_PER_PAGE];
+	size_t i;
+
+	// swap_table에서 연속된 cnt개 slot 찾기
 	lock_acquire(&anon_args_swap.lock_swap);
-	size_t bit = bitmap_scan_and_flip(anon_args_swap.swap_table, 0, 1, false); // 0부터 false 갖는 1개 bit 찾고, 그값 바꾸고 first bit 반환
-	anon_page->num_swap_table = bit; // page에 위치 저장
+	size_t bit = swap_slot_alloc(cnt);
 	lock_release(&anon_args_swap.lock_swap);
 
 	if (bit == BITMAP_ERROR){
-		PANIC("anon_swap_out BITMAP_ERROR\n");
-		return false;
+		if (cnt == 1){
+			PANIC("anon_swap_out BITMAP_ERROR\n");
+			return false;
+		}
+		for (i = 0; i < cnt; i++)
+			if (!swap_write_cluster(&pages[i], 1))
+				return false;
+		return true;
 	}
 
-	// disk에 page 삽입
-	int sect_size = PGSIZE /8;
-	for (int i = 0 ; i < 8; i++){
-		void *addr = page->frame->kva + sect_size * i;
-		disk_write(swap_disk, 8*bit + i, addr);
-	}
-
-	// page frame 변경, pml4에서 지우기
-	pml4_clear_page(thread_current()->pml4, page->va);
-	page->frame = NULL;
+	// page에 위치 저장, 쓰는 도중 주인이 fault 나도 evict가 끝날때까지
+	// 기다렸다가 다 쓴 slot을 읽음
+	for (i = 0; i < cnt; i++)
+		pages[i]->anon.num_swap_table = bit + i;
 
+	// disk에 page 삽입, cluster 전체를 한번에
+	for (i = 0; i < cnt * SECTORS_PER_PAGE; i++)
+		sectors[i] = pages[i / SECTORS_PER_PAGE]->frame->kva
+			+ DISK_SECTOR_SIZE * (i % SECTORS_PER_PAGE);
+	disk_writev(swap_disk, SECTORS_PER_PAGE * bit, sectors, cnt * SECTORS_PER_PAGE);
+	swap_write_cnt++;
+	swap_out_page_cnt += cnt;
 	return true;
 }
 
+/* Writes the page at KVA to a free swap slot and returns the slot,
+ * or BITMAP_ERROR if the swap disk is full.  For pages that zswap
+ * writes back. */
+size_t
+swap_write_page (const void *kva) {
+	const void *sectors[SECTORS_PER_PAGE];
+	size_t i;
+
+	lock_acquire(&anon_args_swap.lock_swap);
+	size_t slot = swap_slot_alloc(1);
+	lock_release(&anon_args_swap.lock_swap);
+	if (slot == BITMAP_ERROR)
+		return slot;
+
+	for (i = 0; i < SECTORS_PER_PAGE; i++)
+		sectors[i] = kva + DISK_SECTOR_SIZE * i;
+	disk_writev(swap_disk, SECTORS_PER_PAGE * slot, sectors, SECTORS_PER_PAGE);
+	swap_write_cnt++;
+	swap_out_page_cnt++;
+	return slot;
+}
+
+/* Allocates CNT consecutive swap slots, next-fit, and returns the
+ * first one, or BITMAP_ERROR if there is no such run.  Must be
+ * called with lock_swap held. */
+static size_t
+swap_slot_alloc (size_t cnt) {
+	struct bitmap *table = anon_args_swap.swap_table;
+	size_t slot = BITMAP_ERROR;
+
+	if (swap_cursor < bitmap_size(table))
+		slot = bitmap_scan_and_flip(table, swap_cursor, cnt, false);
+	if (slot == BITMAP_ERROR && swap_cursor != 0)
+		slot = bitmap_scan_and_flip(table, 0, cnt, false);
+	if (slot != BITMAP_ERROR)
+		swap_cursor = slot + cnt;
+	return slot;
+}
+
+/* Frees the CNT swap slots starting at SLOT. */
+static void
+swap_slot_free (size_t slot, size_t cnt) {
+	lock_acquire(&anon_args_swap.lock_swap);
+	bitmap_set_multiple(anon_args_swap.swap_table, slot, cnt, false);
+	lock_release(&anon_args_swap.lock_swap);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void) {
+	printf ("Swap: %lld pages out in %lld writes, "
+			"%lld pages in in %lld reads (%lld read ahead)\n",
+			swap_out_page_cnt, swap_write_cnt,
+			swap_in_page_cnt, swap_read_cnt, swap_readahead_cnt);
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
 	
 	// P3-2-9 anon_destory 내부 구현
-	if (page->frame != NULL){
-		free(page->frame);
+	vm_frame_release(page);
+	// zswap이나 swap에 있는 page면 반환
+	// (zswap이 먼저: writeback 되면서 slot으로 옮겨갈 수 있음)
+	zswap_invalidate(page);
+	if (anon_page->num_swap_table != -1){
+		swap_slot_free(anon_page->num_swap_table, 1);
+		anon_page->num_swap_table = -1;
 	}
 	if (anon_page->aux != NULL){
-		free(anon_page->aux);
+		kmem_cache_free(load_info_cachep, anon_page->aux);
 	}
 }
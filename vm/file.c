@@ -5,6 +5,7 @@
 #include "threads/vaddr.h" // pg_round_up
 #include "userprog/process.h"
 #include "threads/mmu.h" // pml4_is_dirty
+#include <string.h>
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -38,7 +39,67 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	file_page->zero_bytes = aux->zero_bytes;
 	file_page->is_first_page = aux->is_first_page;
 	file_page->num_left_page = aux-> num_left_page;
+	return true;
+}
+
+/* Returns true if the page FILE_PAGE describes can go in the page
+ * cache: it starts on a page boundary of the file and holds all of
+ * the file that its page of the file does, so that every mapping of
+ * that page of the file sees the same bytes. */
+static bool
+file_page_cacheable (const struct file_page *file_page) {
+	off_t left = file_length(file_page->file) - file_page->ofs;
+
+	return file_page->ofs % PGSIZE == 0 && file_page->read_bytes > 0
+		&& (off_t) file_page->read_bytes == (left < PGSIZE ? left : PGSIZE);
+}
 
+/* Stores in *FILE and *OFS the file and offset PAGE, a file page
+ * or an uninit page that will become one, reads from. */
+static void
+file_page_location (struct page *page, struct file **file, off_t *ofs) {
+	if (VM_TYPE(page->operations->type) == VM_UNINIT){
+		struct page_load_info *aux = page->uninit.aux;
+		*file = aux->file;
+		*ofs = aux->ofs;
+	} else {
+		*file = page->file.file;
+		*ofs = page->file.ofs;
+	}
+}
+
+/* Returns true if OTHER, a page of the current process, maps the
+ * same file as PAGE, a file page, at the same distance in the file
+ * as in memory: that is, if both belong to the same mapping. */
+bool
+file_page_near (struct page *page, struct page *other) {
+	struct file *file, *other_file;
+	off_t ofs, other_ofs;
+
+	if (page_get_type(other) != VM_FILE)
+		return false;
+	file_page_location(page, &file, &ofs);
+	file_page_location(other, &other_file, &other_ofs);
+	return file == other_file
+		&& other_ofs - ofs == (off_t) (other->va - page->va);
+}
+
+/* Maps PAGE, a file page without a frame, to the frame that holds
+ * its contents in the page cache, if there is one, and returns
+ * true.  An uninit PAGE is initialized first, so that on a miss
+ * vm_do_claim_page() reads it in through file_backed_swap_in(). */
+bool
+file_cache_claim (struct page *page) {
+	if (VM_TYPE(page->operations->type) == VM_UNINIT){
+		struct page_load_info *aux = page->uninit.aux;
+		if (!page->uninit.page_initializer(page, page->uninit.type, NULL))
+			return false;
+		kmem_cache_free(load_info_cachep, aux);
+	}
+
+	struct file_page *file_page = &page->file;
+	return file_page_cacheable(file_page)
+		&& vm_cache_map(page, file_get_inode(file_page->file), file_page->ofs);
 }
 
 /* Swap in the page by read contents from the file. */
@@ -46,7 +107,7 @@ static bool
 file_backed_swap_in (struct page *page, void *kva) {
 	struct file_page *file_page UNUSED = &page->file;
 	// P3-5-6 file_swap_in 구현
-	struct page_load_info *aux = (struct page_load_info *) malloc (sizeof(struct page_load_info));
+	struct page_load_info *aux = kmem_cache_alloc (load_info_cachep);
 	aux->file = file_page->file;
 	aux->is_first_page = file_page->is_first_page;
 	aux->num_left_page = file_page->num_left_page;
@@ -64,18 +125,16 @@ file_backed_swap_out (struct page *page) {
 
 	// P3-5-5 file_swap_out 구현
 	// page가 수정된 적 있으면 파일도 수정 해야됨
-	uint64_t *cur_pml4 = thread_current()->pml4;
-	bool is_dirty = pml4_is_dirty(cur_pml4, page->va);
-	
+	// evict 하는 thread가 주인이 아닐 수 있으니 주인의 pml4, frame의 kva 사용
+	// 매핑은 evict 하는 쪽에서 이미 지웠고 dirty bit은 남아 있음
+	bool is_dirty = pml4_is_dirty(page->owner->pml4, page->va);
+
 	// 수정된 이력이 있다면 파일 수정
+	// frame_lock 없이 쓰니 다른 thread와 file 위치를 같이 쓰지 않게 _at으로
 	if (is_dirty == true){
-		file_seek(file_page->file, file_page->ofs);
-		file_write(file_page->file, page->va, file_page->read_bytes);
-		pml4_set_dirty(cur_pml4, page->va, 0); // dirty bit도 원래대로
-	} 
-	pml4_clear_page(cur_pml4, page->va);
-	page->frame = NULL;
-
+		file_write_at(file_page->file, page->frame->kva, file_page->read_bytes,
+				file_page->ofs);
+	}
 	return true;
 
 }
@@ -86,19 +145,16 @@ file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
 	// P3-4-3 file.c 내부 함수들 수정
 	// 메모리에 불러온 내용이 수정되었으면 끌때 실제 파일에도 수정시켜야함
-	if (pml4_is_dirty(thread_current()->pml4, page->va)){ // dirty(수정되었으면)하면
-		file_seek(file_page->file, file_page->ofs);
-		file_write(file_page->file, page->va, file_page->read_bytes);
+	// evict 중이면 끝날때까지 기다리고, 쓰는 동안 evict 되지 않게 pin
+	struct frame *frame = vm_frame_pin_dirty(page);
+	if (frame != NULL){ // dirty(수정되었으면)하면
+		file_write_at(file_page->file, frame->kva, file_page->read_bytes,
+				file_page->ofs);
+		vm_frame_unpin(frame);
 	}
-	page->writable = true;
-	memset(page->va, 0, PGSIZE); // va의 메모리 0으로 초기화
 	hash_delete(&thread_current()->spt.hash_table, &page->page_hash_elem);
 	
-	if (page->frame){
-		free(page->frame);
-	}
-
-	page->frame = NULL;
+	vm_frame_release(page);
 	page->file.file = NULL;
 	page->file.is_first_page = NULL;
 	page->file.num_left_page = NULL;
@@ -132,81 +188,47 @@ do_mmap (void *addr, size_t length, int writable,
 	// zero로 채워야할 bytes
 	uint32_t zero_bytes = pg_round_up(real_read_bytes) - real_read_bytes;
 	
-	// 만들 페이지 개수
-	int page_num = (int) pg_round_up(real_read_bytes) / PGSIZE;
-
-	// 만들 페이지가 이미 존재 하는지 확인
-	for (int i = 0; i < page_num; i++){
-		if(spt_find_page(&thread_current()->spt, addr + i * PGSIZE) != NULL){
-			return NULL;
-		}
+	// mapping 전체를 VMA 하나로, page는 처음 접근할때 만들어짐
+	// 이미 mapping 된 page와 겹치면 fail
+	// mapping 전체가 reopen 한 file 하나를 같이 씀, munmap에서 close
+	struct file *reopen_file = file_reopen(file);
+	if (reopen_file == NULL){
+		return NULL;
 	}
-
-	bool is_first = true; // 첫번째 page인가?
-	void *upage = addr; // return을 처음 addr 해야되서
-
-	while (real_read_bytes > 0 || zero_bytes > 0){
-		// page에 read할 bytes
-		size_t page_read_bytes;
-		if (real_read_bytes > PGSIZE){
-			page_read_bytes = PGSIZE;
-		} else {
-			page_read_bytes = real_read_bytes;
-		}
-		// page에 zero넣을 bytes
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		// initializer에 필요한 aux 설정
-		struct page_load_info *aux = (struct page_load_info *) malloc(sizeof(struct page_load_info));
-		struct file *reopen_file = file_reopen(file);
-		aux->file = reopen_file;
-		aux->ofs = offset;
-		aux->read_bytes = page_read_bytes;
-		aux->zero_bytes = page_zero_bytes;
-		aux->is_first_page = is_first;
-		aux->num_left_page = page_num -1;
-
-		// is_first, page_num, offset update
-		if (is_first){
-			is_first = false;
-		}
-		page_num = page_num -1;
-		offset = offset + page_read_bytes;
-
-		// VM_FILE -> vm_alloc_page_with_init
-		if (!vm_alloc_page_with_initializer (VM_FILE, upage, writable, file_lazy_load_segment, aux)){
-			//printf("file load segment vm_alloc fail\n");
-			return NULL;
-		}
-
-		// read_bytes, zero_bytes, addr update
-		real_read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		upage += PGSIZE;
-
+	struct vma *vma = vm_map_range(addr, real_read_bytes + zero_bytes, VM_FILE,
+			writable, reopen_file, offset, real_read_bytes,
+			file_lazy_load_segment);
+	if (vma == NULL){
+		file_close(reopen_file);
+		return NULL;
 	}
-
+	vma->mmap = true;
 	return addr;
 }
 
+/* Maps the SIZE bytes at UPAGE read-only to FILE, the current
+ * process's executable: READ_BYTES bytes from OFS, then zeros.
+ * Called by load_segment() for code segments.  Unlike anon pages,
+ * the pages go through the page cache, so every process running
+ * the same binary maps the same frames and execs after the first
+ * read nothing from disk; and when evicted they are read back from
+ * FILE rather than swapped. */
+bool
+file_map_text (void *upage, size_t size, struct file *file, off_t ofs,
+		size_t read_bytes) {
+	return vm_map_range (upage, size, VM_FILE, false, file, ofs, read_bytes,
+			file_lazy_load_segment) != NULL;
+}
+
 /* Do the munmap */
 void
 do_munmap (void *addr) {
-	struct page *first_page = spt_find_page(&thread_current()->spt, addr);
-	int munmap_page_num = first_page->file.num_left_page;
-	// printf("left page: %d\n", first_page->file.num_left_page);
-
-	struct file *file = first_page->file.file;
-
-	for (int i =0 ; i<= munmap_page_num; i++){
-		struct page *del =spt_find_page(&thread_current()->spt, addr + i * PGSIZE);
-		if (del == NULL){
-			PANIC("In munmap, no page");
-		}
-		spt_destroy_func(&del->page_hash_elem, NULL);
-
+	// addr에서 시작하는 mmap 영역만, 만들어진 page들은 dirty면 file에 쓰고 없앰
+	struct vma *vma = vma_find(&thread_current()->spt.vmas, addr);
+	if (vma == NULL || vma->start != addr || !vma->mmap){
+		return;
 	}
-	file_close(file);
+	vm_unmap_range(vma);
 }
 
 // P3-4-2 initializer에 필요한 함수 file_lazy_load_segment
@@ -214,19 +236,24 @@ static bool file_lazy_load_segment (struct page *page, void *aux){
 	uint8_t *pa = (page->frame)->kva; //실제 메모리 주소
 	struct page_load_info *args = aux;
 	uint32_t read_bytes = args->read_bytes;
+	uint32_t zero_bytes = args->zero_bytes;
 
 	//파일에서 ofs만큼 커서이동 후 파일 읽기
 	file_seek(args->file, args->ofs);
 	uint32_t real_read_bytes = (uint32_t) file_read(args->file, pa, read_bytes);
 	
 	// 만약 실제 읽은 bytes랑 읽어햐하는 bytes 다르면 free and return false
+	kmem_cache_free(load_info_cachep, aux);
 	if (real_read_bytes != read_bytes){
-		palloc_free_page(pa);
 		return false;
-	} else { // 같으면 0으로 zero_bytes만큼 초기화
-		memset(pa+read_bytes, 0, args->zero_bytes);
-		free(aux);
-		return true;
 	}
+	// 같으면 0으로 zero_bytes만큼 초기화
+	memset(pa+read_bytes, 0, zero_bytes);
+
+	// 다른 mapping이 같이 쓸 수 있게 page cache에 넣기
+	if (file_page_cacheable(&page->file))
+		vm_cache_insert(page->frame, file_get_inode(page->file.file),
+				page->file.ofs);
+	return true;
 
 }
\ No newline at end of file
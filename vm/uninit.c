@@ -68,6 +68,6 @@ uninit_destroy (struct page *page) {
 	/* TODO: Fill this function.
 	 * TODO: If you don't have anything to do, just return. */
 	// P3-2-8 uninit_destory 내부 구현
-	free(uninit->aux);
+	kmem_cache_free(load_info_cachep, uninit->aux);
 	return;
 }
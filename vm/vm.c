@@ -8,9 +8,78 @@
 #include "threads/mmu.h"
 #include "userprog/process.h"
 #include <string.h>
-
-// P3-victim
-struct list victim_list;
+#include <stdio.h>
+#include "threads/synch.h"
+#include "vm/zswap.h"
+#include "filesys/inode.h"
+
+/* Global frame table.  Every user frame that is mapped by some
+ * process is on FRAME_TABLE, and CLOCK_HAND points at the next
+ * frame that the clock algorithm examines; it keeps its position
+ * from one eviction to the next.  FRAME_LOCK protects both, and
+ * every frame's PAGE, PAGES, REFCNT, PIN_CNT, EVICTING and cache
+ * fields.
+ * A frame being evicted is written out without FRAME_LOCK; anyone
+ * who needs one of its pages waits on EVICT_COND until it is done,
+ * in frame_wait_evict(). */
+static struct list frame_table;
+static struct list_elem *clock_hand;
+static struct lock frame_lock;
+static struct condition evict_cond;
+
+/* Page cache.  A frame that holds a page of a file, read in for a
+ * file-backed mapping, is also in PAGE_CACHE under the file's
+ * inode and the page's offset.  Every mapping of that page, in any
+ * process and across repeated mmaps, maps the same frame, which
+ * stays cached when the last mapping goes until it is evicted.
+ * The frame keeps the inode open.  Protected by FRAME_LOCK. */
+static struct hash page_cache;
+static uint64_t frame_cache_hash (const struct hash_elem *, void *);
+static bool frame_cache_less (const struct hash_elem *,
+		const struct hash_elem *, void *);
+static struct frame *frame_cache_find (struct inode *, off_t ofs);
+
+/* Background reclaim.  When an allocation leaves fewer than
+ * FREE_LOW free user frames, vm_get_frame wakes the kswapd thread,
+ * which evicts frames in batches of KSWAPD_BATCH and gives them
+ * back to the user pool until FREE_HIGH frames are free.  Faults
+ * then usually find a free frame without waiting for a swap
+ * write; they evict directly only if the pool runs dry anyway. */
+#define KSWAPD_BATCH 16
+static size_t free_low, free_high;
+static struct semaphore kswapd_sema;
+static bool kswapd_woken;          /* kswapd_sema already raised. */
+static void kswapd (void *aux);
+
+/* Fault-around.  A fault on a file page also maps the other pages
+ * of the same mapping in the aligned window of FAULT_AROUND_PAGES
+ * pages around it: those in the page cache just get mapped, and the
+ * others are read in while free frames last, without evicting.  Set
+ * by the -fault-around kernel option; 1, the default, turns it
+ * off, so that pages are loaded one fault at a time. */
+int fault_around_pages = 1;
+static void vm_fault_around (struct page *page);
+
+/* Statistics. */
+static long long evict_cnt;        /* Frames evicted. */
+static long long clock_step_cnt;   /* Frames examined by the clock. */
+static long long direct_evict_cnt; /* Evictions done by faulting threads. */
+static long long kswapd_wake_cnt;  /* Times kswapd was woken. */
+static long long kswapd_free_cnt;  /* Frames kswapd gave back. */
+static long long cow_share_cnt;    /* Frames shared by fork. */
+static long long cow_copy_cnt;     /* Write faults that copied a frame. */
+static long long cow_reuse_cnt;    /* Write faults on a frame no longer shared. */
+static long long cow_evict_cnt;    /* Shared frames evicted, sharing broken. */
+static long long cache_hit_cnt;    /* File page faults served by the cache. */
+static long long cache_insert_cnt; /* Frames added to the cache. */
+static long long cache_evict_cnt;  /* Cached frames evicted. */
+static long long around_map_cnt;   /* Pages fault-around took from the cache. */
+static long long around_read_cnt;  /* Pages fault-around read in. */
+
+struct kmem_cache *page_cachep;
+struct kmem_cache *frame_cachep;
+struct kmem_cache *load_info_cachep;
+static struct kmem_cache *vma_cachep;
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -24,8 +93,24 @@ vm_init (void) {
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	// P3-victim-1 victim_list 초기화
-	list_init(&victim_list);
+	list_init(&frame_table);
+	clock_hand = list_end(&frame_table);
+	lock_init(&frame_lock);
+	cond_init(&evict_cond);
+	hash_init(&page_cache, frame_cache_hash, frame_cache_less, NULL);
+
+	// watermark는 user pool 크기 기준: low = 1/64 (최소 8), high = 2 * low
+	size_t user_pages = palloc_free_page_cnt(PAL_USER);
+	free_low = user_pages / 64 > 8 ? user_pages / 64 : 8;
+	free_high = 2 * free_low;
+	sema_init(&kswapd_sema, 0);
+	thread_create("kswapd", PRI_DEFAULT, kswapd, NULL);
+
+	page_cachep = kmem_cache_create ("page", sizeof (struct page), NULL);
+	frame_cachep = kmem_cache_create ("frame", sizeof (struct frame), NULL);
+	load_info_cachep = kmem_cache_create ("page_load_info",
+			sizeof (struct page_load_info), NULL);
+	vma_cachep = kmem_cache_create ("vma", sizeof (struct vma), NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -46,6 +131,7 @@ page_get_type (struct page *page) {
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
 static struct frame *vm_evict_frame (void);
+static bool frame_test_accessed (struct frame *);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -67,7 +153,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
 		// P3-2-1 vm_alloc_page_with_initializer 내부 구현
-		struct page *page = (struct page *) malloc(sizeof(struct page));
+		struct page *page = kmem_cache_alloc (page_cachep);
 		if (page == NULL){
 			return false;
 		}
@@ -89,10 +175,15 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		// 받은 argument로 page 상태 설정
 		page->writable = writable;
 		page->page_vm_type = type;
+		page->owner = thread_current();
 
 		/* TODO: Insert the page into the spt. */
 		// spt에 새로 만들어진 page 삽입
 		if(spt_insert_page(spt, page)){
+			// page를 덮는 VMA에 연결, munmap과 fork가 VMA 단위로 찾음
+			page->vma = vma_find(&spt->vmas, upage);
+			if (page->vma != NULL)
+				list_push_back(&page->vma->pages, &page->vma_elem);
 			return true;
 		}
 
@@ -126,6 +217,102 @@ spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 
 }
 
+/* Creates the page at VA, which VMA covers, in the current
+ * process's spt, as the VMA describes it: a lazily loaded page of
+ * the VMA's file, or a page of zeros past the file's bytes. */
+static struct page *
+vma_page_create (struct vma *vma, void *va) {
+	size_t delta = va - vma->start;
+	bool succ;
+
+	if (vma->file != NULL && delta < vma->read_bytes){
+		struct page_load_info *aux = kmem_cache_alloc (load_info_cachep);
+		if (aux == NULL)
+			return NULL;
+		aux->file = vma->file;
+		aux->ofs = vma->ofs + delta;
+		aux->read_bytes = vma->read_bytes - delta < PGSIZE
+			? vma->read_bytes - delta : PGSIZE;
+		aux->zero_bytes = PGSIZE - aux->read_bytes;
+		aux->is_first_page = va == vma->start;
+		aux->num_left_page = (vma->end - va) / PGSIZE - 1;
+		succ = vm_alloc_page_with_initializer (vma->type, va, vma->writable,
+				vma->init, aux);
+		if (!succ)
+			kmem_cache_free (load_info_cachep, aux);
+	} else
+		succ = vm_alloc_page (vma->file != NULL ? VM_ANON : vma->type, va,
+				vma->writable);
+	return succ ? spt_find_page (&thread_current ()->spt, va) : NULL;
+}
+
+/* Returns the page of the current process at VA, making it from
+ * the VMA that covers VA if it has not been touched yet.  Returns
+ * NULL if no VMA covers VA. */
+struct page *
+spt_get_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page = spt_find_page (spt, va);
+
+	if (page == NULL){
+		struct vma *vma = vma_find (&spt->vmas, va);
+		if (vma != NULL)
+			page = vma_page_create (vma, pg_round_down (va));
+	}
+	return page;
+}
+
+/* Maps the SIZE bytes from START, a page boundary, in the current
+ * process: a VMA whose pages are made on first touch by
+ * spt_get_page().  The first READ_BYTES bytes come from FILE from
+ * OFS, each page loaded by INIT into a page of TYPE; the rest are
+ * zeros.  Returns the new VMA, or NULL if the range overlaps a
+ * mapping already there or memory runs out. */
+struct vma *
+vm_map_range (void *start, size_t size, enum vm_type type, bool writable,
+		struct file *file, off_t ofs, size_t read_bytes,
+		vm_initializer *init) {
+	ASSERT (pg_ofs (start) == 0);
+
+	struct vma *vma = kmem_cache_alloc (vma_cachep);
+	if (vma == NULL)
+		return NULL;
+
+	vma->start = start;
+	vma->end = pg_round_up (start + size);
+	vma->type = type;
+	vma->writable = writable;
+	vma->mmap = false;
+	vma->file = file;
+	vma->ofs = ofs;
+	vma->read_bytes = read_bytes;
+	vma->init = init;
+	list_init (&vma->pages);
+	if (vma->end < vma->start || !is_user_vaddr (vma->end - 1)
+			|| !vma_insert (&thread_current ()->spt.vmas, vma)){
+		kmem_cache_free (vma_cachep, vma);
+		return NULL;
+	}
+	return vma;
+}
+
+/* Destroys the pages of VMA, a mapping of the current process, and
+ * VMA itself, closing its file if it was made by mmap(). */
+void
+vm_unmap_range (struct vma *vma) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	while (!list_empty (&vma->pages)){
+		struct page *page = list_entry (list_front (&vma->pages),
+				struct page, vma_elem);
+		hash_delete (&spt->hash_table, &page->page_hash_elem);
+		spt_destroy_func (&page->page_hash_elem, NULL);
+	}
+	vma_remove (&spt->vmas, vma);
+	if (vma->mmap)
+		file_close (vma->file);
+	kmem_cache_free (vma_cachep, vma);
+}
+
 /* Insert PAGE into spt with validation. */
 bool
 spt_insert_page (struct supplemental_page_table *spt UNUSED,
@@ -145,108 +332,558 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Advances the clock hand by one frame, wrapping around at the
+ * end of the frame table.  Must be called with FRAME_LOCK held. */
+static void
+clock_advance (void) {
+	if (clock_hand != list_end(&frame_table))
+		clock_hand = list_next(clock_hand);
+	if (clock_hand == list_end(&frame_table))
+		clock_hand = list_begin(&frame_table);
+}
+
+/* Get the struct frame, that will be evicted.
+ * Must be called with FRAME_LOCK held. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
 	 /* TODO: The policy for eviction is up to you. */
+	// clock 알고리즘: hand 위치부터 accessed bit 확인
+	// accessed bit은 frame 주인의 pml4에서 확인 (thread_current 아님)
+	// 모든 frame이 pinned면 두 바퀴 돌고 포기
+	size_t max_steps = 2 * list_size(&frame_table);
+
+	if (clock_hand == list_end(&frame_table))
+		clock_hand = list_begin(&frame_table);
+
+	for (size_t i = 0; i < max_steps; i++){
+		struct frame *frame = list_entry(clock_hand, struct frame, frame_elem);
+		clock_step_cnt++;
+
+		// 공유 중인 (copy-on-write) frame과 page cache의 frame은
+		// 매핑한 page들 모두 unmap 하고 evict
+		if (frame->pin_cnt > 0){
+			clock_advance();
+			continue;
+		}
+
+		if (frame_test_accessed(frame)){
+			// 최근에 access 한 경우, 한번 더 기회 줌
+			clock_advance();
+		} else {
+			// hand는 victim 다음 frame부터 다음 eviction 시작
+			clock_advance();
+			return frame;
+		}
+	}
+	return NULL;
+}
 
-	 struct list_elem *victim_elem = list_front(&victim_list);
+/* Returns true if any page that maps FRAME was accessed since the
+ * last call, and clears their accessed bits.  The bits are in the
+ * owners' page tables, not the current thread's.  Must be called
+ * with FRAME_LOCK held. */
+static bool
+frame_test_accessed (struct frame *frame) {
+	bool accessed = false;
+
+	for (struct list_elem *e = list_begin(&frame->pages);
+			e != list_end(&frame->pages); e = list_next(e)){
+		struct page *page = list_entry(e, struct page, map_elem);
+		uint64_t *pml4 = page->owner->pml4;
+		if (pml4_is_accessed(pml4, page->va)){
+			pml4_set_accessed(pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
 
+/* Adds PAGE to the pages that map FRAME.  Must be called with
+ * FRAME_LOCK held. */
+static void
+frame_add_page (struct frame *frame, struct page *page) {
+	list_push_back(&frame->pages, &page->map_elem);
+	frame->refcnt++;
+	frame->page = list_entry(list_front(&frame->pages), struct page, map_elem);
+	page->frame = frame;
+}
 
-	// victim_list 에서 제거할 frame 선택
-	 while (1){
-			struct page *victim_page = list_entry (victim_elem, struct page, victim_list_elem);
-			void *victim_addr = victim_page->va;
+/* Removes PAGE from the pages that map FRAME.  Must be called
+ * with FRAME_LOCK held. */
+static void
+frame_remove_page (struct frame *frame, struct page *page) {
+	list_remove(&page->map_elem);
+	frame->refcnt--;
+	frame->page = frame->refcnt > 0
+		? list_entry(list_front(&frame->pages), struct page, map_elem) : NULL;
+	page->frame = NULL;
+}
 
-			// 해당 페이지에 access 하지 않은 경우
-			if (pml4_is_accessed(&thread_current()->pml4, victim_addr) == false){
-				list_remove(victim_elem);
-				return victim_page->frame;
-			} else { // accesss 한경우
-				// 페이지의 accesssed bit 0으로 설정
-				pml4_set_accessed(&thread_current()->pml4, victim_addr, 0);
-				// victim_elem 다음으로 설정
-				victim_elem = list_next(victim_elem);
+/* Drops FRAME from the page cache and closes its inode.  Must be
+ * called with FRAME_LOCK held. */
+static void
+frame_cache_remove (struct frame *frame) {
+	hash_delete(&page_cache, &frame->cache_elem);
+	inode_close(frame->inode);
+	frame->inode = NULL;
+}
 
-				// victim_elem 마지막 element면 처음부터 다시
-				if(victim_elem == list_end(&victim_list)){
-					victim_elem = list_front(&victim_list);
-				}
+/* Removes FRAME from the frame table.  Must be called with
+ * FRAME_LOCK held. */
+static void
+frame_table_remove (struct frame *frame) {
+	if (clock_hand == &frame->frame_elem)
+		clock_hand = list_next(clock_hand);
+	list_remove(&frame->frame_elem);
+}
 
-			}
-		
-	 }
+/* Collects in FRAMES the victim and the frames after it in the
+ * frame table whose anon pages the victim can be swapped out
+ * together with: same owner, next virtual page, not pinned and not
+ * recently accessed.  Returns the number of frames, at most
+ * SWAP_CLUSTER_MAX.  Must be called with FRAME_LOCK held. */
+static size_t
+gather_swap_cluster (struct frame *victim, struct frame *frames[]) {
+	size_t cnt = 1;
+
+	frames[0] = victim;
+	if (victim->refcnt != 1 || victim->page->operations->type != VM_ANON)
+		return cnt;
+
+	for (struct list_elem *e = list_next(&victim->frame_elem);
+			cnt < SWAP_CLUSTER_MAX && e != list_end(&frame_table);
+			e = list_next(e)){
+		struct frame *f = list_entry(e, struct frame, frame_elem);
+		if (f->pin_cnt > 0 || f->refcnt != 1
+				|| f->page->owner != victim->page->owner
+				|| f->page->operations->type != VM_ANON
+				|| f->page->va != frames[cnt - 1]->page->va + PGSIZE
+				|| pml4_is_accessed(f->page->owner->pml4, f->page->va))
+			break;
+		frames[cnt++] = f;
+	}
+	return cnt;
+}
 
-	return victim;
+/* Unmaps FRAME, which is being evicted, from every page that maps
+ * it.  The dirty bits stay in the page tables for the swap out to
+ * look at.  Must be called with FRAME_LOCK held. */
+static void
+frame_unmap (struct frame *frame) {
+	for (struct list_elem *e = list_begin(&frame->pages);
+			e != list_end(&frame->pages); e = list_next(e)){
+		struct page *page = list_entry(e, struct page, map_elem);
+		pml4_clear_page(page->owner->pml4, page->va);
+	}
 }
 
-/* Evict one page and return the corresponding frame.
+/* Maps FRAME, whose eviction failed, back to every page that
+ * mapped it.  Read-only: a write fault makes it writable again in
+ * vm_handle_wp().  Must be called with FRAME_LOCK held. */
+static void
+frame_remap (struct frame *frame) {
+	for (struct list_elem *e = list_begin(&frame->pages);
+			e != list_end(&frame->pages); e = list_next(e)){
+		struct page *page = list_entry(e, struct page, map_elem);
+		uint64_t *pml4 = page->owner->pml4;
+		bool dirty = pml4_is_dirty(pml4, page->va);
+		if (pml4_set_page(pml4, page->va, frame->kva, false) && dirty)
+			pml4_set_dirty(pml4, page->va, true);
+	}
+}
+
+/* Waits while PAGE's frame is being evicted.  PAGE has no frame
+ * afterward unless the eviction failed.  Must be called with
+ * FRAME_LOCK held. */
+static void
+frame_wait_evict (struct page *page) {
+	while (page->frame != NULL && page->frame->evicting)
+		cond_wait(&evict_cond, &frame_lock);
+}
+
+/* Writes FRAME, a page cache frame being evicted, back to its file
+ * if any page that mapped it wrote to it.  Called without
+ * FRAME_LOCK: the pages of a frame being evicted stay as they are
+ * until it is done. */
+static bool
+frame_cache_writeback (struct frame *frame) {
+	bool dirty = false;
+
+	for (struct list_elem *e = list_begin(&frame->pages);
+			e != list_end(&frame->pages); e = list_next(e)){
+		struct page *page = list_entry(e, struct page, map_elem);
+		if (pml4_is_dirty(page->owner->pml4, page->va))
+			dirty = true;
+	}
+
+	if (dirty){
+		off_t len = inode_length(frame->inode) - frame->ofs;
+		inode_write_at(frame->inode, frame->kva, len < PGSIZE ? len : PGSIZE,
+				frame->ofs);
+	}
+	return true;
+}
+
+/* Swaps out FRAME, which is being evicted while pages of several
+ * processes share it copy-on-write.  The sharing is broken: each
+ * anon page gets a copy of its own in swap, the anon pages in
+ * batches of SWAP_CLUSTER_MAX copies, and each file page is
+ * written back if its own mapping dirtied it.  Called without
+ * FRAME_LOCK, like frame_cache_writeback(). */
+static bool
+frame_swap_out_shared (struct frame *frame) {
+	struct page *pages[SWAP_CLUSTER_MAX];
+	size_t cnt = 0;
+
+	for (struct list_elem *e = list_begin(&frame->pages);
+			e != list_end(&frame->pages); e = list_next(e)){
+		struct page *page = list_entry(e, struct page, map_elem);
+		if (page->operations->type != VM_ANON){
+			if (!swap_out(page))
+				return false;
+			continue;
+		}
+		pages[cnt++] = page;
+		if (cnt == SWAP_CLUSTER_MAX){
+			if (!anon_swap_out_cluster(pages, cnt))
+				return false;
+			cnt = 0;
+		}
+	}
+	return cnt == 0 || anon_swap_out_cluster(pages, cnt);
+}
+
+/* Evict one page and return the corresponding frame, pinned.
+ * An anon victim takes the virtually adjacent anon pages that
+ * follow it in the frame table to swap with it, in one disk
+ * request; their frames go back to the user pool.  A frame shared
+ * copy-on-write is swapped out once for each page that maps it.
+ * The victims are picked, pinned and unmapped with FRAME_LOCK
+ * held, then written out with it released, so that faults and
+ * other evictions do not wait for the disk.
  * Return NULL on error.*/
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
+	struct frame *frames[SWAP_CLUSTER_MAX];
+	struct page *pages[SWAP_CLUSTER_MAX];
+	size_t cnt, i;
+	bool succ;
+
+	lock_acquire(&frame_lock);
+	struct frame *victim = vm_get_victim ();
+	if (victim == NULL){
+		lock_release(&frame_lock);
+		return NULL;
+	}
+
 	/* TODO: swap out the victim and return the evicted frame. */
-	// victim을 swap out 하기
-	if (swap_out(victim->page) == false){ // swap_out 실패(error)시 NULL 반환
+	// victim을 pin 하고 매핑한 page들의 pml4에서 지우기
+	// 그 뒤로 주인이 fault 나거나 page를 없애려 하면 frame_wait_evict()에서
+	// 기다리니 I/O는 frame_lock 없이 함
+	if (victim->inode != NULL){
+		frames[0] = victim;
+		cnt = 1;
+	} else
+		cnt = gather_swap_cluster(victim, frames);
+	for (i = 0; i < cnt; i++){
+		frames[i]->pin_cnt++;
+		frames[i]->evicting = true;
+		frame_unmap(frames[i]);
+		pages[i] = frames[i]->page;
+	}
+	lock_release(&frame_lock);
+
+	if (victim->inode != NULL)
+		succ = frame_cache_writeback(victim);
+	else if (victim->refcnt > 1){
+		succ = frame_swap_out_shared(victim);
+		if (succ)
+			cow_evict_cnt++;
+	} else if (cnt > 1)
+		succ = anon_swap_out_cluster(pages, cnt);
+	else
+		succ = swap_out(victim->page);
+
+	lock_acquire(&frame_lock);
+	for (i = 0; i < cnt; i++){
+		struct frame *frame = frames[i];
+		frame->evicting = false;
+		if (succ == false){ // swap_out 실패(error)시 다시 매핑하고 NULL 반환
+			frame_remap(frame);
+			frame->pin_cnt--;
+			continue;
+		}
+		while (!list_empty(&frame->pages))
+			frame_remove_page(frame, list_entry(list_front(&frame->pages),
+						struct page, map_elem));
+		if (frame->inode != NULL){
+			frame_cache_remove(frame);
+			cache_evict_cnt++;
+		}
+	}
+	cond_broadcast(&evict_cond, &frame_lock);
+	if (succ == false){
+		lock_release(&frame_lock);
 		return NULL;
 	}
 
-	// victim의 page 초기화
-	victim->page = NULL;
+	// 같이 swap out 된 frame들은 user pool에 반환
+	// victim은 table에 그대로 두고 재사용
+	for (i = 1; i < cnt; i++){
+		frame_table_remove(frames[i]);
+		palloc_free_page(frames[i]->kva);
+		kmem_cache_free(frame_cachep, frames[i]);
+	}
+	evict_cnt += cnt;
+	lock_release(&frame_lock);
 	return victim;
 }
 
+/* Allocates a user page and puts a frame for it on the frame
+ * table, pinned and without a page.  Returns NULL if the user pool
+ * is empty. */
+static struct frame *
+frame_alloc (enum palloc_flags flags) {
+	void *kva = palloc_get_page(PAL_USER | flags);
+	if (kva == NULL)
+		return NULL;
+
+	// 새로 할당된 메모리와 페이지 연결
+	struct frame *frame = kmem_cache_alloc (frame_cachep);
+	ASSERT (frame != NULL);
+
+	// 프레임 정보 init, claim 끝날때까지 pin
+	frame->page = NULL; // 페이지와의 연결 아직 안함
+	list_init(&frame->pages);
+	frame->refcnt = 0;
+	frame->kva = kva; // 프레임에 새로만든 va 저장
+	frame->pin_cnt = 1;
+	frame->evicting = false;
+	frame->inode = NULL;
+
+	// frame table에 추가, clock hand 바로 뒤 (한바퀴 뒤에 검사됨)
+	lock_acquire(&frame_lock);
+	if (clock_hand == list_end(&frame_table))
+		list_push_back(&frame_table, &frame->frame_elem);
+	else
+		list_insert(clock_hand, &frame->frame_elem);
+	lock_release(&frame_lock);
+
+	return frame;
+}
+
+/* Returns a pinned frame without a page if the user pool has a
+ * free page, or NULL without evicting anything otherwise.  For
+ * speculative reads, which are not worth an eviction. */
+struct frame *
+vm_frame_alloc_noevict (void) {
+	return frame_alloc(0);
+}
+
+/* Removes FRAME, which must not hold a page, from the frame table
+ * and frees it and its memory. */
+void
+vm_frame_free (struct frame *frame) {
+	ASSERT (frame->refcnt == 0);
+
+	lock_acquire(&frame_lock);
+	frame_table_remove(frame);
+	lock_release(&frame_lock);
+	palloc_free_page(frame->kva);
+	kmem_cache_free(frame_cachep, frame);
+}
+
+/* Drops a pin on FRAME, which may be evicted once nothing pins it. */
+void
+vm_frame_unpin (struct frame *frame) {
+	lock_acquire(&frame_lock);
+	ASSERT (frame->pin_cnt > 0);
+	frame->pin_cnt--;
+	lock_release(&frame_lock);
+}
+
+/* Returns PAGE's frame, pinned, if PAGE has one and wrote to it,
+ * or NULL otherwise.  Waits first if the frame is being evicted,
+ * after which PAGE has no frame.  For writing a page back to its
+ * file before it goes; the caller unpins the frame. */
+struct frame *
+vm_frame_pin_dirty (struct page *page) {
+	lock_acquire(&frame_lock);
+	frame_wait_evict(page);
+	struct frame *frame = page->frame;
+	if (frame != NULL && pml4_is_dirty(page->owner->pml4, page->va))
+		frame->pin_cnt++;
+	else
+		frame = NULL;
+	lock_release(&frame_lock);
+	return frame;
+}
+
+/* Links PAGE and FRAME and maps PAGE's address to the frame in the
+ * current thread's page table.  Returns false, leaving FRAME
+ * without a page, if the page table cannot be updated. */
+bool
+vm_frame_map (struct page *page, struct frame *frame) {
+	/* Set links */
+	lock_acquire(&frame_lock);
+	frame_add_page(frame, page);
+	lock_release(&frame_lock);
+
+	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	// P3-1-6 vm_do_claim_page 함수 내부 구현
+	// Claim: 페이지를 프레임에 할당하는 것
+	if (pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable) == false){
+		lock_acquire(&frame_lock);
+		frame_remove_page(frame, page);
+		lock_release(&frame_lock);
+		return false;
+	}
+	return true;
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * space.  The frame is on the frame table and pinned; the caller unpins
+ * it once the page's contents are in place. */
 static struct frame *
-vm_get_frame (void) {
+vm_get_frame (bool zero) {
 	/* TODO: Fill this function. */
 	// P3-1-5 vm_get_frame 함수 구현
-	void *new = palloc_get_page(PAL_USER);
+	// ZERO면 0으로 채워진 frame 필요 (idle이 미리 0으로 채워둔 page 사용)
+	struct frame *frame = frame_alloc(zero ? PAL_ZERO : 0);
 
-	// 메모리 가득차서 새로운 프레임 생성 못하면 evict
-	if (new == NULL){
-		return vm_evict_frame();
+	// free frame이 low watermark 아래로 내려가면 kswapd 깨우기
+	if (!kswapd_woken && palloc_free_page_cnt(PAL_USER) < free_low){
+		kswapd_woken = true;
+		sema_up(&kswapd_sema);
 	}
 
-	// 새로 할당된 메모리와 페이지 연결
-	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
-	ASSERT (frame != NULL);
-
-	// 프레임 정보 init
-	frame->page = NULL; // 페이지와의 연결 아직 안함
-	frame->kva = new; // 프레임에 새로만든 va 저장
+	// 메모리 가득차서 새로운 프레임 생성 못하면 직접 evict
+	if (frame == NULL){
+		frame = vm_evict_frame();
+		direct_evict_cnt++;
+		if (frame != NULL && zero){
+			memset(frame->kva, 0, PGSIZE);
+		}
+	}
 
 	return frame;
 }
 
-/* Growing the stack. */
+/* Evicts up to KSWAPD_BATCH frames and gives them back to the
+ * user pool.  Returns the number of frames freed. */
+static size_t
+kswapd_reclaim (void) {
+	size_t cnt;
+
+	for (cnt = 0; cnt < KSWAPD_BATCH; cnt++){
+		// clean file page는 write 없이, dirty anon page는 swap에 써서 비움
+		struct frame *frame = vm_evict_frame();
+		if (frame == NULL)
+			break;
+		vm_frame_free(frame);
+	}
+	kswapd_free_cnt += cnt;
+	return cnt;
+}
+
+/* Page reclaim thread.  Sleeps until vm_get_frame notices that
+ * free user frames dropped below FREE_LOW, then evicts until
+ * FREE_HIGH frames are free or nothing more can be evicted. */
 static void
+kswapd (void *aux UNUSED) {
+	for (;;){
+		sema_down(&kswapd_sema);
+		kswapd_wake_cnt++;
+		while (palloc_free_page_cnt(PAL_USER) < free_high)
+			if (kswapd_reclaim() == 0)
+				break;
+		kswapd_woken = false;
+	}
+}
+
+/* Growing the stack. */
+static bool
 vm_stack_growth (void *addr UNUSED) {
 	// P3-3-2 vm_stack_growth 함수 구현
 	// 조건에 맞을시 stack growth 실행하는 것
 
-	void *round_addr = pg_round_down(addr);
+	// stack VMA를 addr까지 아래로 늘리고 fault 난 page만 claim
+	// 그 사이 page들은 처음 접근할때 0으로 채워진 page로 만들어짐
+	struct vma_tree *vmas = &thread_current()->spt.vmas;
+	struct vma *stack = vma_find(vmas, (void *) USER_STACK - PGSIZE);
+	if (stack == NULL || !vma_grow_down(vmas, stack, pg_round_down(addr))){
+		return false;
+	}
+	return vm_claim_page(addr);
+}
 
-	struct page *page;
-	while((page = spt_find_page(&thread_current()->spt, round_addr)) == NULL){
-		if((vm_alloc_page(VM_ANON|VM_MARKER_0, round_addr, true)) && vm_claim_page(round_addr)){
-			memset(round_addr, 0, PGSIZE);
-			round_addr += PGSIZE;
-		} else { // alloc, claim 실패시
-			palloc_free_page(round_addr);
-			PANIC("alloc, claim fail in growth stack");
-		}
+/* Handle the fault on write_protected page */
+// fork 후 copy-on-write로 공유 중인 page에 write 한 경우
+// 아직 공유 중이면 새 frame에 복사해서 따로 쓰고, 이제 혼자 쓰는 frame이면 복사 없이 writable로
+static bool
+vm_handle_wp (struct page *page) {
+	struct frame *copy = NULL;
+
+	lock_acquire(&frame_lock);
+	if (page->frame != NULL && page->frame->refcnt > 1
+			&& page->frame->inode == NULL){
+		// 복사할 frame 먼저 구하기, evict 할 수도 있어서 lock 놓고
+		lock_release(&frame_lock);
+		copy = vm_get_frame(false);
+		if (copy == NULL)
+			return false;
+		lock_acquire(&frame_lock);
+	}
+
+	struct frame *frame = page->frame;
+	if (frame == NULL || frame->evicting){
+		// 그 사이에 공유가 풀려서 evict 됨, 다시 fault 나서 swap in
+	} else if (frame->refcnt == 1 || frame->inode != NULL){
+		// page cache의 frame은 file에 쓰는 것이라 복사 없이 같이 씀
+		pml4_set_writable(thread_current()->pml4, page->va, true);
+		cow_reuse_cnt++;
+	} else {
+		memcpy(copy->kva, frame->kva, PGSIZE);
+		frame_remove_page(frame, page);
+		frame_add_page(copy, page);
+		pml4_clear_page(thread_current()->pml4, page->va); // TLB에서도 지우기
+		pml4_set_page(thread_current()->pml4, page->va, copy->kva, true);
+		copy->pin_cnt--;
+		copy = NULL;
+		cow_copy_cnt++;
 	}
+	lock_release(&frame_lock);
 
+	if (copy != NULL)
+		vm_frame_free(copy);
+	return true;
 }
 
-/* Handle the fault on write_protected page */
+/* If SRC has a frame, makes DST, a page of the current process,
+ * share it copy-on-write: both map it read-only, and the first to
+ * write gets its own copy in vm_handle_wp().  Sets *SHARED to
+ * whether SRC had a frame.  Returns false if DST cannot be
+ * mapped. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_share_frame (struct page *src, struct page *dst, bool *shared) {
+	bool succ = true;
+
+	lock_acquire(&frame_lock);
+	frame_wait_evict(src);
+	struct frame *frame = src->frame;
+	*shared = frame != NULL;
+	if (frame != NULL){
+		succ = pml4_set_page(thread_current()->pml4, dst->va, frame->kva, false);
+		if (succ){
+			pml4_set_writable(src->owner->pml4, src->va, false);
+			frame_add_page(frame, dst);
+			cow_share_cnt++;
+		}
+	}
+	lock_release(&frame_lock);
+	return succ;
 }
 
 /* Return true on success */
@@ -276,9 +913,9 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		stack_pointer = f->rsp;
 	}
 
-	// spt에서 addr 찾기
-	struct page *page = spt_find_page(spt, addr);
-	if (page == NULL){ // spt에 없는 page면
+	// spt에서 addr 찾기, 처음 접근하는 page면 VMA에서 만들기
+	struct page *page = spt_get_page(spt, addr);
+	if (page == NULL){ // VMA에 없는 주소면
 		// P3-3-1 stack growth 조건 추가
 		// stack 다 찰경우 page 더 만들어서 추가하게 구현
 		// stack pointer 8bytes 아래에서 page fault 발생가능
@@ -286,8 +923,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		if (user && write){
 			if ( (USER_STACK - (1<<20)) < addr && addr < USER_STACK){
 				if (((int)stack_pointer)-32 <= (int) addr){ //addr가 stack_pointer 8byte 아래 가르키면
-					vm_stack_growth(addr); // stack growth
-					return true;
+					return vm_stack_growth(addr); // stack growth
 				}
 			}
 		}
@@ -298,9 +934,166 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 		if (page->writable == 0 && write){
 			return false;
 		}
-		return vm_do_claim_page (page);
+		// page가 있는데 fault면 copy-on-write 중인 page에 write 한 것
+		if (!not_present){
+			return write && vm_handle_wp (page);
+		}
+		if (!vm_do_claim_page (page)){
+			return false;
+		}
+		vm_fault_around (page);
+		return true;
+	}
+
+}
+
+/* Unmaps PAGE from its frame, if it has one.  The frame and its
+ * memory are freed once no page maps it any more.  Called by the
+ * page types' destroy functions, in the owner's context. */
+void
+vm_frame_release (struct page *page) {
+	lock_acquire(&frame_lock);
+	frame_wait_evict(page);
+	struct frame *frame = page->frame;
+	if (frame != NULL){
+		// pml4_destroy가 공유 중인 frame을 free 하지 않게 mapping 지우기
+		pml4_clear_page(page->owner->pml4, page->va);
+		frame_remove_page(frame, page);
+		// page cache의 frame은 매핑이 없어도 evict 될때까지 남겨둠
+		if (frame->refcnt == 0 && frame->inode == NULL){
+			frame_table_remove(frame);
+			palloc_free_page(frame->kva);
+			kmem_cache_free(frame_cachep, frame);
+		}
+	}
+	lock_release(&frame_lock);
+}
+
+/* If the page of INODE at OFS is in the page cache, maps PAGE, a
+ * page of the current process that has no frame, to its frame and
+ * returns true.  Otherwise returns false. */
+bool
+vm_cache_map (struct page *page, struct inode *inode, off_t ofs) {
+	bool succ = false;
+
+	lock_acquire(&frame_lock);
+	// evict 되는 중인 frame은 file에 다 쓰고 cache에서 빠질때까지 기다리기
+	struct frame *frame;
+	while ((frame = frame_cache_find(inode, ofs)) != NULL && frame->evicting)
+		cond_wait(&evict_cond, &frame_lock);
+	if (frame != NULL
+			&& pml4_set_page(thread_current()->pml4, page->va, frame->kva,
+				page->writable)){
+		frame_add_page(frame, page);
+		cache_hit_cnt++;
+		succ = true;
+	}
+	lock_release(&frame_lock);
+	return succ;
+}
+
+/* Adds FRAME, which holds the page of INODE at OFS, to the page
+ * cache.  Does nothing if another frame got there first. */
+void
+vm_cache_insert (struct frame *frame, struct inode *inode, off_t ofs) {
+	lock_acquire(&frame_lock);
+	frame->inode = inode;
+	frame->ofs = ofs;
+	if (hash_insert(&page_cache, &frame->cache_elem) == NULL){
+		inode_reopen(inode);
+		cache_insert_cnt++;
+	} else
+		frame->inode = NULL;
+	lock_release(&frame_lock);
+}
+
+/* Called by inode_write_at() after it wrote SIZE bytes from BUF to
+ * INODE at OFS.  Rereads the bytes written into the cached frames
+ * they fall in, so mappings see what write() wrote.  Each frame is
+ * found and pinned with FRAME_LOCK held and reread with it
+ * released, so that neither the disk nor user memory, which may
+ * fault, is touched with it held.  A frame that is its own source,
+ * being written back by eviction, is skipped. */
+void
+vm_cache_update (struct inode *inode, const void *buf, off_t ofs,
+		off_t size) {
+	// cache가 비어 있으면 (vm_init 전 포함) lock 없이 바로 return
+	if (hash_empty(&page_cache))
+		return;
+
+	for (off_t pos = ofs - ofs % PGSIZE; pos < ofs + size; pos += PGSIZE){
+		// evict 되는 중인 frame은 cache에서 빠질때까지 기다리기
+		lock_acquire(&frame_lock);
+		struct frame *frame;
+		while ((frame = frame_cache_find(inode, pos)) != NULL
+				&& frame->evicting && frame->kva != buf)
+			cond_wait(&evict_cond, &frame_lock);
+		if (frame == NULL || frame->kva == buf){
+			lock_release(&frame_lock);
+			continue;
+		}
+		frame->pin_cnt++;
+		lock_release(&frame_lock);
+
+		off_t start = pos > ofs ? pos : ofs;
+		off_t end = pos + PGSIZE < ofs + size ? pos + PGSIZE : ofs + size;
+		inode_read_at(inode, frame->kva + (start - pos), end - start, start);
+		vm_frame_unpin(frame);
 	}
+}
 
+/* Returns the frame that caches the page of INODE at OFS, or NULL.
+ * Must be called with FRAME_LOCK held. */
+static struct frame *
+frame_cache_find (struct inode *inode, off_t ofs) {
+	struct frame key;
+	struct hash_elem *e;
+
+	key.inode = inode;
+	key.ofs = ofs;
+	e = hash_find(&page_cache, &key.cache_elem);
+	return e != NULL ? hash_entry(e, struct frame, cache_elem) : NULL;
+}
+
+/* Hashes a cached frame by its inode and offset. */
+static uint64_t
+frame_cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry(e, struct frame, cache_elem);
+	return hash_bytes(&f->inode, sizeof f->inode) ^ hash_int(f->ofs);
+}
+
+/* Orders cached frames by inode, then offset. */
+static bool
+frame_cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry(a_, struct frame, cache_elem);
+	const struct frame *b = hash_entry(b_, struct frame, cache_elem);
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->ofs < b->ofs;
+}
+
+/* Prints frame table statistics. */
+void
+vm_print_stats (void) {
+	printf ("Frames: %zu in table, %lld evicted, %lld clock steps\n",
+			list_size(&frame_table), evict_cnt, clock_step_cnt);
+	printf ("Frames: kswapd woken %lld times, freed %lld frames; "
+			"%lld direct evictions (watermarks %zu/%zu)\n",
+			kswapd_wake_cnt, kswapd_free_cnt, direct_evict_cnt,
+			free_low, free_high);
+	printf ("Frames: %lld shared by fork, %lld copied on write, "
+			"%lld reused on write, %lld evicted while shared\n",
+			cow_share_cnt, cow_copy_cnt, cow_reuse_cnt, cow_evict_cnt);
+	printf ("Page cache: %lld hits, %lld frames cached, %lld evicted, "
+			"%zu cached now\n",
+			cache_hit_cnt, cache_insert_cnt, cache_evict_cnt,
+			hash_size (&page_cache));
+	printf ("Fault-around: %lld pages mapped from the cache, %lld read in\n",
+			around_map_cnt, around_read_cnt);
+	swap_print_stats ();
+	if (zswap_enabled)
+		zswap_print_stats ();
 }
 
 /* Free the page.
@@ -308,7 +1101,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	kmem_cache_free (page_cachep, page);
 }
 
 /* Claim the page that allocate on VA. */
@@ -317,7 +1110,7 @@ vm_claim_page (void *va UNUSED) {
 	struct page *page = NULL;
 	/* TODO: Fill this function */
 	// P3-1-7 vm_claim_page 구현
-	page = spt_find_page(&thread_current()->spt, va);
+	page = spt_get_page(&thread_current()->spt, va);
 
 	if (page == NULL){
 		return false;
@@ -326,31 +1119,107 @@ vm_claim_page (void *va UNUSED) {
 	return vm_do_claim_page (page);
 }
 
+/* Maps the pages of PAGE's mapping in the window around PAGE, a
+ * file page that was just claimed.  See FAULT_AROUND_PAGES. */
+static void
+vm_fault_around (struct page *page) {
+	if (fault_around_pages <= 1 || page_get_type(page) != VM_FILE)
+		return;
+
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct vma *vma = page->vma;
+	uintptr_t window = (uintptr_t) fault_around_pages * PGSIZE;
+	void *start = (void *) ((uintptr_t) page->va / window * window);
+
+	if (vma == NULL)
+		return;
+	for (int i = 0; i < fault_around_pages; i++){
+		void *va = start + i * PGSIZE;
+		// 같은 VMA 안의 page만, 아직 없으면 VMA에서 만들기
+		if (va == page->va || va < vma->start || va >= vma->end)
+			continue;
+		struct page *p = spt_get_page(spt, va);
+		if (p == NULL || p->frame != NULL || !file_page_near(page, p))
+			continue;
+
+		// page cache에 있으면 매핑만, 없으면 남는 frame 있을때만 읽기
+		if (file_cache_claim(p)){
+			around_map_cnt++;
+			continue;
+		}
+		struct frame *frame = vm_frame_alloc_noevict();
+		if (frame == NULL)
+			break;
+		if (!vm_frame_map(p, frame)){
+			vm_frame_free(frame);
+			break;
+		}
+		if (swap_in(p, frame->kva)){
+			vm_frame_unpin(frame);
+			around_read_cnt++;
+		} else {
+			vm_frame_release(p);
+		}
+	}
+}
+
+/* Faults in the pages of the current process in the LENGTH bytes
+ * from ADDR, like the first touch of each would, for mmap() with
+ * MAP_POPULATE.  Stops at the first page that is missing or cannot
+ * be claimed; the rest stay lazy. */
+void
+vm_prefault (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current()->spt;
+
+	for (void *va = addr; va < addr + length; va += PGSIZE){
+		struct page *page = spt_get_page(spt, va);
+		if (page == NULL)
+			break;
+		if (page->frame != NULL)
+			continue;
+		if (!vm_do_claim_page(page))
+			break;
+		vm_fault_around(page);
+	}
+}
+
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	// evict 되는 중인 page면 다 쓸때까지 기다렸다가 다시 읽기
+	// evict가 실패해서 다시 매핑됐으면 그대로 사용
+	lock_acquire(&frame_lock);
+	frame_wait_evict(page);
+	bool resident = page->frame != NULL;
+	lock_release(&frame_lock);
+	if (resident){
+		return true;
+	}
+
+	// file page는 page cache에 있으면 새 frame 없이 그 frame 같이 매핑
+	if (page_get_type(page) == VM_FILE && file_cache_claim(page)){
+		return true;
+	}
+
+	// initializer 없는 anon page (stack 등)는 0으로 채워진 frame 필요
+	bool demand_zero = VM_TYPE(page->operations->type) == VM_UNINIT
+		&& page->uninit.init == NULL
+		&& VM_TYPE(page->uninit.type) == VM_ANON;
+	struct frame *frame = vm_get_frame (demand_zero);
 
 	if (frame == NULL){
 		printf("frame is NULL\n");
 		return false;
 	}
 
-	/* Set links */
-	frame->page = page;
-	page->frame = frame;
-
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
-	// P3-1-6 vm_do_claim_page 함수 내부 구현
-	// Claim: 페이지를 프레임에 할당하는 것
-	if (pml4_set_page(thread_current()->pml4, page->va, frame->kva, page->writable) == false){
+	if (vm_frame_map (page, frame) == false){
+		vm_frame_free (frame);
 		return false;
 	}
-	
-	// P3-victim-2 claim 할때 victim list에 추가
-	list_push_back(&victim_list, &page->victim_list_elem);
 
+	// swap_in (disk/file I/O) 끝날때까지 pin 유지
 	bool succ = swap_in (page, frame->kva);
+	vm_frame_unpin(frame);
 	return succ;
 }
 
@@ -359,9 +1228,62 @@ void
 supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	// P3-1-2. spt init 함수 구현
 	hash_init(&spt->hash_table, page_hash_hash, page_hash_less, NULL);
+	vma_tree_init(&spt->vmas);
 	
 }
 
+/* Adds to the current process's supplemental page table a copy of
+ * P, an anon or file page of the parent.  If P is resident, the
+ * copy shares its frame copy-on-write; a swapped-out anon page is
+ * copied into a new frame; a file page that is not resident stays
+ * that way, to be read from its file. */
+static bool
+vm_copy_page (struct page *p) {
+	struct page *child_p = kmem_cache_alloc (page_cachep);
+	if (child_p == NULL)
+		return false;
+
+	memcpy(child_p, p, sizeof *child_p);
+	child_p->frame = NULL;
+	child_p->owner = thread_current();
+	// 자식의 VMA에 연결, file page는 자식 VMA의 file (reopen 한 것)로
+	child_p->vma = vma_find(&thread_current()->spt.vmas, p->va);
+	if (child_p->vma != NULL){
+		list_push_back(&child_p->vma->pages, &child_p->vma_elem);
+		if (p->operations->type == VM_FILE)
+			child_p->file.file = child_p->vma->file;
+	}
+	if (p->operations->type == VM_ANON){
+		child_p->anon.aux = NULL;
+		child_p->anon.num_swap_table = -1;
+		child_p->anon.zentry = NULL;
+	}
+	if (!spt_insert_page(&thread_current()->spt, child_p)){
+		if (child_p->vma != NULL)
+			list_remove(&child_p->vma_elem);
+		kmem_cache_free(page_cachep, child_p);
+		return false;
+	}
+
+	bool shared;
+	if (!vm_share_frame(p, child_p, &shared))
+		return false;
+	if (shared || p->operations->type != VM_ANON)
+		return true;
+
+	// swap out 된 anon page는 부모 slot은 그대로 두고 내용만 복사
+	struct frame *frame = vm_get_frame(false);
+	if (frame == NULL)
+		return false;
+	anon_copy_swapped(p, frame->kva);
+	if (!vm_frame_map(child_p, frame)){
+		vm_frame_free(frame);
+		return false;
+	}
+	vm_frame_unpin(frame);
+	return true;
+}
+
 /* Copy supplemental page table from src to dst */
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
@@ -371,13 +1293,31 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 	ASSERT(src != NULL);
 	ASSERT(dst != NULL);
 
+	// VMA 먼저 복사: mmap 영역은 file을 reopen, 실행 파일의
+	// segment는 자식이 복제한 실행 파일로
+	for (struct vma *v = vma_next(&src->vmas, NULL); v != NULL;
+			v = vma_next(&src->vmas, v->end)){
+		struct file *file = v->file;
+		if (file != NULL)
+			file = v->mmap ? file_reopen(file) : thread_current()->running_file;
+		if (v->file != NULL && file == NULL)
+			return false;
+		struct vma *child_v = vm_map_range(v->start, v->end - v->start,
+				v->type, v->writable, file, v->ofs, v->read_bytes, v->init);
+		if (child_v == NULL){
+			if (v->mmap)
+				file_close(file);
+			return false;
+		}
+		child_v->mmap = v->mmap;
+	}
+
 	struct hash_iterator iter;
 	// iter를 설정
 	hash_first(&iter, &src->hash_table);
 
 	// hash_table 순회
 	bool succ = true;
-	struct page_load_info *aux= NULL;
 
 	while (hash_next(&iter) != NULL){
 		struct page *p = hash_entry(hash_cur(&iter), struct page, page_hash_elem);
@@ -385,34 +1325,12 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 
 		switch (p_type){
 			case VM_UNINIT: // lazy_loading이 한번도 일어나지 않음
-				aux = (struct page_load_info *) malloc(sizeof(struct page_load_info));
-				memcpy(aux, p->uninit.aux, sizeof(struct page_load_info));
-				if (!vm_alloc_page_with_initializer(p->page_vm_type, p->va, p->writable, p->uninit.init, aux)){
-					return false;
-				}
+				// 자식의 VMA가 처음 접근할때 똑같이 만들어 줌
 				break;
 			case VM_ANON:
-				// 똑같은 va가리킬 page 복제
-				if(!vm_alloc_page(VM_ANON|VM_MARKER_0, p->va, p->writable)){
-					return false;
-				}
-				if(!vm_claim_page(p->va)){
-					return false;
-				}
-				struct page *child_p = spt_find_page(&thread_current()->spt, p->va);
-				memcpy(child_p->va, p->frame->kva, PGSIZE);
-				break;
 			case VM_FILE: // P3-4-3 추가 수정
-				// aux 복제
-				aux = (struct page_load_info *) malloc(sizeof(struct page_load_info));
-				aux->file = p->file.file;
-				aux->is_first_page = p->file.is_first_page;
-				aux->num_left_page = p->file.num_left_page;
-				aux->ofs = p->file.ofs;
-				aux->read_bytes = p->file.read_bytes;
-				aux->zero_bytes = p->file.zero_bytes;
-
-				if(!vm_alloc_page_with_initializer(VM_FILE, p->va, p->writable, NULL, aux)){
+				// page 구조체 복제, frame은 copy-on-write로 공유
+				if (!vm_copy_page(p)){
 					return false;
 				}
 				break;
@@ -430,6 +1348,8 @@ supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 // P3-2-7 spt_kill 구현 보조 함수
 void spt_destroy_func(struct hash_elem *e, void *aux){
 	struct page *page = hash_entry(e, struct page, page_hash_elem);
+	if (page->vma != NULL)
+		list_remove(&page->vma_elem);
 	vm_dealloc_page(page);
 }
 
@@ -442,6 +1362,14 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	
 	// P3-2-7 spt_kill 함수 내부 구현
 	hash_destroy(&spt->hash_table, spt_destroy_func);
+
+	// page가 다 없어진 뒤 VMA들 정리
+	struct vma *vma;
+	while ((vma = vma_pop(&spt->vmas)) != NULL){
+		if (vma->mmap)
+			file_close(vma->file);
+		kmem_cache_free(vma_cachep, vma);
+	}
 }
 
 // P3-1-2 보조 함수 구현
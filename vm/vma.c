@@ -0,0 +1,188 @@
+/* vma.c: Tree of a process's virtual memory areas.
+ *
+ * The VMAs are kept in a top-down splay tree keyed by address.  A
+ * lookup moves the VMA found to the root, so the run of faults on
+ * one area that a process usually takes costs one comparison each.
+ * No VMA overlaps another, so a VMA is "less than" an address when
+ * it ends at or before it and "greater" when it starts after it. */
+
+#include "vm/vm.h"
+#include <debug.h>
+
+/* Splays the tree rooted at T around ADDR and returns the new root:
+ * the VMA that contains ADDR if there is one, otherwise the VMA
+ * just before or just after ADDR. */
+static struct vma *
+splay (struct vma *t, const void *addr) {
+	struct vma head, *l, *r, *y;
+
+	if (t == NULL)
+		return NULL;
+
+	head.left = head.right = NULL;
+	l = r = &head;
+	for (;;) {
+		if (addr < t->start) {
+			if (t->left == NULL)
+				break;
+			if (addr < t->left->start) {
+				/* Rotate right. */
+				y = t->left;
+				t->left = y->right;
+				y->right = t;
+				t = y;
+				if (t->left == NULL)
+					break;
+			}
+			/* Link right. */
+			r->left = t;
+			r = t;
+			t = t->left;
+		} else if (addr >= t->end) {
+			if (t->right == NULL)
+				break;
+			if (addr >= t->right->end) {
+				/* Rotate left. */
+				y = t->right;
+				t->right = y->left;
+				y->left = t;
+				t = y;
+				if (t->right == NULL)
+					break;
+			}
+			/* Link left. */
+			l->right = t;
+			l = t;
+			t = t->right;
+		} else
+			break;
+	}
+
+	/* Assemble. */
+	l->right = t->left;
+	r->left = t->right;
+	t->left = head.right;
+	t->right = head.left;
+	return t;
+}
+
+/* Initializes TREE as empty. */
+void
+vma_tree_init (struct vma_tree *tree) {
+	tree->root = NULL;
+}
+
+/* Returns the VMA in TREE that contains ADDR, or NULL. */
+struct vma *
+vma_find (struct vma_tree *tree, const void *addr) {
+	struct vma *vma;
+
+	tree->root = splay (tree->root, addr);
+	vma = tree->root;
+	if (vma != NULL && vma->start <= addr && addr < vma->end)
+		return vma;
+	return NULL;
+}
+
+/* Returns the first VMA in TREE that ends after ADDR, or NULL.
+ * Leaves the tree as it is, so that the VMAs can be walked in order
+ * with vma_next (tree, vma->end). */
+struct vma *
+vma_next (struct vma_tree *tree, const void *addr) {
+	struct vma *next = NULL;
+	struct vma *t = tree->root;
+
+	while (t != NULL) {
+		if (t->end > addr) {
+			next = t;
+			t = t->left;
+		} else
+			t = t->right;
+	}
+	return next;
+}
+
+/* Returns true if a VMA in TREE has a page in [START, END). */
+bool
+vma_overlaps (struct vma_tree *tree, const void *start, const void *end) {
+	struct vma *next = vma_next (tree, start);
+
+	return next != NULL && next->start < end;
+}
+
+/* Inserts VMA into TREE.  Returns false, leaving TREE unchanged, if
+ * VMA is empty or overlaps a VMA already in TREE. */
+bool
+vma_insert (struct vma_tree *tree, struct vma *vma) {
+	struct vma *t;
+
+	if (vma->start >= vma->end
+			|| vma_overlaps (tree, vma->start, vma->end))
+		return false;
+
+	t = splay (tree->root, vma->start);
+	if (t == NULL)
+		vma->left = vma->right = NULL;
+	else if (vma->start < t->start) {
+		vma->left = t->left;
+		vma->right = t;
+		t->left = NULL;
+	} else {
+		vma->right = t->right;
+		vma->left = t;
+		t->right = NULL;
+	}
+	tree->root = vma;
+	return true;
+}
+
+/* Removes VMA, which must be in TREE, from TREE. */
+void
+vma_remove (struct vma_tree *tree, struct vma *vma) {
+	struct vma *t = splay (tree->root, vma->start);
+
+	ASSERT (t == vma);
+	if (t->left == NULL)
+		tree->root = t->right;
+	else {
+		/* Every VMA on the left ends before VMA starts, so this
+		 * brings the last of them up, with no right child. */
+		tree->root = splay (t->left, vma->start);
+		tree->root->right = t->right;
+	}
+}
+
+/* Extends VMA, which is in TREE, down to START.  Returns false,
+ * leaving VMA unchanged, if that would overlap another VMA. */
+bool
+vma_grow_down (struct vma_tree *tree, struct vma *vma, void *start) {
+	if (start >= vma->start)
+		return true;
+	if (vma_overlaps (tree, start, vma->start))
+		return false;
+
+	// 아래쪽 VMA들은 모두 START 전에 끝나므로 tree 순서는 그대로
+	vma->start = start;
+	return true;
+}
+
+/* Removes some VMA from TREE and returns it, or returns NULL if
+ * TREE is empty.  For tearing down a whole tree without recursing,
+ * which a kernel stack cannot afford for a degenerate tree. */
+struct vma *
+vma_pop (struct vma_tree *tree) {
+	struct vma *t = tree->root;
+
+	if (t == NULL)
+		return NULL;
+
+	// 왼쪽 child가 없어질때까지 오른쪽으로 회전
+	while (t->left != NULL) {
+		struct vma *l = t->left;
+		t->left = l->right;
+		l->right = t;
+		t = l;
+	}
+	tree->root = t->right;
+	return t;
+}
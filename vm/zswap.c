@@ -0,0 +1,264 @@
+/* zswap.c: Compressed cache in front of the swap disk.
+ *
+ * With -zswap, an anon page that is evicted is compressed into
+ * kernel memory instead of being written to the swap disk, and a
+ * fault on it decompresses it from there.  A page of zeros is kept
+ * as an entry without data.  Pages that do not compress to
+ * ZSWAP_MAX_SIZE bytes go to the disk as before.
+ *
+ * The compressed data is malloc()ed, so it comes from the kernel
+ * pool.  The pool may use ZSWAP_POOL_PERCENT percent of what the
+ * kernel pool had free at boot.  When a new page does not fit, the
+ * oldest entries are decompressed and written to the swap disk
+ * until it does. */
+
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* Largest share of the free kernel pool the pool may take. */
+#define ZSWAP_POOL_PERCENT 20
+
+/* Pages that compress to more than this go to the disk.  malloc()
+ * serves bigger blocks with a whole page, which would save nothing. */
+#define ZSWAP_MAX_SIZE (PGSIZE / 4)
+
+/* A page in the pool. */
+struct zswap_entry {
+	struct page *page;          /* The swapped-out page. */
+	struct list_elem elem;      /* In lru_list. */
+	size_t size;                /* Compressed size, 0 for a zero page. */
+	void *data;                 /* Compressed data, NULL for a zero page. */
+};
+
+bool zswap_enabled;
+
+/* ZSWAP_LOCK protects everything below, and the zentry member
+ * of every anon page. */
+static struct lock zswap_lock;
+static struct list lru_list;        /* Entries, oldest first. */
+static size_t pool_bytes;           /* Memory the entries' data take. */
+static size_t pool_max;             /* Limit on POOL_BYTES. */
+static struct kmem_cache *entry_cachep;
+static struct lz_state lz_state;    /* Compressor scratch space. */
+static uint8_t *compress_buf;       /* Compressor output. */
+static uint8_t *writeback_buf;      /* Page being written back. */
+
+/* Statistics. */
+static long long store_cnt;         /* Pages stored. */
+static long long zero_cnt;          /* ...of which were all zeros. */
+static long long reject_cnt;        /* Pages sent to the disk instead. */
+static long long hit_cnt;           /* Swap-ins served from the pool. */
+static long long miss_cnt;          /* Swap-ins that went to the disk. */
+static long long writeback_cnt;     /* Entries written back to make room. */
+static long long stored_bytes;      /* Compressed size of stored pages. */
+
+static bool is_zero_page (const void *kva);
+static void entry_decompress (const struct zswap_entry *, void *kva);
+static void entry_free (struct zswap_entry *);
+static bool writeback_oldest (void);
+
+/* Sets up the pool.  Called by vm_anon_init() with -zswap. */
+void
+zswap_init (void) {
+	lock_init (&zswap_lock);
+	list_init (&lru_list);
+	pool_max = palloc_free_page_cnt (0) * PGSIZE
+		/ 100 * ZSWAP_POOL_PERCENT;
+	entry_cachep = kmem_cache_create ("zswap_entry",
+			sizeof (struct zswap_entry), NULL);
+	compress_buf = palloc_get_page (PAL_ASSERT);
+	writeback_buf = palloc_get_page (PAL_ASSERT);
+}
+
+/* Stores the contents of PAGE's frame in the pool, writing back
+ * older entries if needed to make room.  Returns true if stored,
+ * false if the page should go to the swap disk.  The page must no
+ * longer be mapped, so that it cannot change meanwhile. */
+bool
+zswap_store (struct page *page) {
+	const void *kva = page->frame->kva;
+	struct zswap_entry *e;
+	size_t size = 0;
+	void *data = NULL;
+
+	lock_acquire (&zswap_lock);
+	if (!is_zero_page (kva)) {
+		size = lz_compress (&lz_state, kva, PGSIZE, compress_buf,
+				ZSWAP_MAX_SIZE);
+		if (size == 0 || malloc_footprint (size) >= PGSIZE)
+			goto reject;
+
+		// pool이 차면 오래된 entry부터 disk로
+		while (pool_bytes + malloc_footprint (size) > pool_max)
+			if (!writeback_oldest ())
+				goto reject;
+
+		data = malloc (size);
+		if (data == NULL)
+			goto reject;
+		memcpy (data, compress_buf, size);
+		pool_bytes += malloc_footprint (size);
+	} else
+		zero_cnt++;
+
+	e = kmem_cache_alloc (entry_cachep);
+	if (e == NULL) {
+		if (data != NULL) {
+			pool_bytes -= malloc_footprint (size);
+			free (data);
+		}
+		goto reject;
+	}
+	e->page = page;
+	e->size = size;
+	e->data = data;
+	list_push_back (&lru_list, &e->elem);
+	page->anon.zentry = e;
+	store_cnt++;
+	stored_bytes += size;
+	lock_release (&zswap_lock);
+	return true;
+
+reject:
+	reject_cnt++;
+	lock_release (&zswap_lock);
+	return false;
+}
+
+/* If PAGE is in the pool, decompresses it into KVA, drops it from
+ * the pool and returns true.  Otherwise returns false: the page is
+ * on the swap disk. */
+bool
+zswap_load (struct page *page, void *kva) {
+	struct zswap_entry *e;
+
+	if (!zswap_enabled)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	e = page->anon.zentry;
+	if (e == NULL) {
+		miss_cnt++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+	entry_decompress (e, kva);
+	list_remove (&e->elem);
+	page->anon.zentry = NULL;
+	entry_free (e);
+	hit_cnt++;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Like zswap_load(), but leaves PAGE in the pool.  For fork. */
+bool
+zswap_copy (struct page *page, void *kva) {
+	struct zswap_entry *e;
+
+	if (!zswap_enabled)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	e = page->anon.zentry;
+	if (e != NULL)
+		entry_decompress (e, kva);
+	lock_release (&zswap_lock);
+	return e != NULL;
+}
+
+/* Drops PAGE from the pool, if it is there, when the page is
+ * destroyed. */
+void
+zswap_invalidate (struct page *page) {
+	struct zswap_entry *e;
+
+	if (!zswap_enabled)
+		return;
+
+	lock_acquire (&zswap_lock);
+	e = page->anon.zentry;
+	if (e != NULL) {
+		list_remove (&e->elem);
+		page->anon.zentry = NULL;
+		entry_free (e);
+	}
+	lock_release (&zswap_lock);
+}
+
+/* Prints zswap statistics. */
+void
+zswap_print_stats (void) {
+	long long ratio = stored_bytes > 0
+		? store_cnt * PGSIZE * 100 / stored_bytes : 0;
+
+	printf ("Zswap: %lld pages stored (%lld zero), %lld rejected, "
+			"%lld written back\n",
+			store_cnt, zero_cnt, reject_cnt, writeback_cnt);
+	printf ("Zswap: %lld hits, %lld misses, compression ratio %lld.%02lld, "
+			"%zu of %zu pool bytes in use\n",
+			hit_cnt, miss_cnt, ratio / 100, ratio % 100, pool_bytes, pool_max);
+}
+
+/* Returns true if the page at KVA holds only zeros. */
+static bool
+is_zero_page (const void *kva) {
+	const uint64_t *p = kva;
+	size_t i;
+
+	for (i = 0; i < PGSIZE / sizeof *p; i++)
+		if (p[i] != 0)
+			return false;
+	return true;
+}
+
+/* Decompresses entry E into the page at KVA. */
+static void
+entry_decompress (const struct zswap_entry *e, void *kva) {
+	if (e->data == NULL)
+		memset (kva, 0, PGSIZE);
+	else if (lz_decompress (e->data, e->size, kva, PGSIZE) != PGSIZE)
+		PANIC ("zswap: corrupted entry for page %p", e->page->va);
+}
+
+/* Frees entry E, which must not be on LRU_LIST. */
+static void
+entry_free (struct zswap_entry *e) {
+	if (e->data != NULL) {
+		pool_bytes -= malloc_footprint (e->size);
+		free (e->data);
+	}
+	kmem_cache_free (entry_cachep, e);
+}
+
+/* Writes the oldest entry to the swap disk and frees it.  Returns
+ * false if the pool is empty or the swap disk is full. */
+static bool
+writeback_oldest (void) {
+	struct zswap_entry *e;
+	size_t slot;
+
+	if (list_empty (&lru_list))
+		return false;
+
+	e = list_entry (list_front (&lru_list), struct zswap_entry, elem);
+	entry_decompress (e, writeback_buf);
+	slot = swap_write_page (writeback_buf);
+	if (slot == BITMAP_ERROR)
+		return false;
+
+	list_remove (&e->elem);
+	e->page->anon.zentry = NULL;
+	e->page->anon.num_swap_table = slot;
+	entry_free (e);
+	writeback_cnt++;
+	return true;
+}